@@ -1,9 +1,193 @@
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+//------------------------------BigIntegerStats-------------------------------//
+
+// Opt-in instrumentation: compile with -DBIGINTEGER_STATS to collect counters,
+// otherwise every hook below is an empty inline call.
+struct BigIntegerStats {
+#ifdef BIGINTEGER_STATS
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  enum class Kernel { MUL = 0, DIV = 1, NORMALIZE = 2, GCD = 3 };
+  static const size_t kernels_count = 4;
+  // bucket i holds operands of [2^(i-1), 2^i) limbs, the last one is open
+  static const size_t histogram_buckets = 24;
+
+  struct Snapshot {
+    std::array<unsigned long long, kernels_count> calls{};
+    std::array<unsigned long long, kernels_count> nanoseconds{};
+    std::array<std::array<unsigned long long, histogram_buckets>, kernels_count>
+        operand_limbs{};
+    unsigned long long allocations = 0;
+    unsigned long long deallocations = 0;
+    unsigned long long allocated_bytes = 0;
+  };
+
+  // RAII guard timing one kernel call, the time is inclusive of nested kernels
+  class ScopedKernel {
+   public:
+    ScopedKernel(Kernel kernel, size_t operand_limbs);
+    ~ScopedKernel();
+
+   private:
+    Kernel kernel_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  template <typename T>
+  struct CountingAllocator : std::allocator<T> {
+    using value_type = T;
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+    template <typename U>
+    struct rebind {
+      using other = CountingAllocator<U>;
+    };
+    T* allocate(size_t count);
+    void deallocate(T* ptr, size_t count);
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+      return true;
+    }
+  };
+
+  static Snapshot snapshot();
+  static void reset();
+  static void record_allocation(size_t bytes);
+  static void record_deallocation();
+
+ private:
+  using Counter = std::atomic<unsigned long long>;
+  inline static std::array<Counter, kernels_count> calls_{};
+  inline static std::array<Counter, kernels_count> nanoseconds_{};
+  inline static std::array<std::array<Counter, histogram_buckets>,
+                           kernels_count>
+      operand_limbs_{};
+  inline static Counter allocations_{0};
+  inline static Counter deallocations_{0};
+  inline static Counter allocated_bytes_{0};
+};
+
+BigIntegerStats::ScopedKernel::ScopedKernel(Kernel kernel,
+                                            size_t operand_limbs)
+    : kernel_(kernel) {
+  if constexpr (enabled) {
+    size_t index = static_cast<size_t>(kernel);
+    size_t bucket = std::min<size_t>(std::bit_width(operand_limbs),
+                                     histogram_buckets - 1);
+    calls_[index].fetch_add(1, std::memory_order_relaxed);
+    operand_limbs_[index][bucket].fetch_add(1, std::memory_order_relaxed);
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+BigIntegerStats::ScopedKernel::~ScopedKernel() {
+  if constexpr (enabled) {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    nanoseconds_[static_cast<size_t>(kernel_)].fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+        std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+T* BigIntegerStats::CountingAllocator<T>::allocate(size_t count) {
+  record_allocation(count * sizeof(T));
+  return std::allocator<T>::allocate(count);
+}
+
+template <typename T>
+void BigIntegerStats::CountingAllocator<T>::deallocate(T* ptr, size_t count) {
+  record_deallocation();
+  std::allocator<T>::deallocate(ptr, count);
+}
+
+BigIntegerStats::Snapshot BigIntegerStats::snapshot() {
+  Snapshot snap;
+  for (size_t i = 0; i < kernels_count; ++i) {
+    snap.calls[i] = calls_[i].load(std::memory_order_relaxed);
+    snap.nanoseconds[i] = nanoseconds_[i].load(std::memory_order_relaxed);
+    for (size_t j = 0; j < histogram_buckets; ++j) {
+      snap.operand_limbs[i][j] =
+          operand_limbs_[i][j].load(std::memory_order_relaxed);
+    }
+  }
+  snap.allocations = allocations_.load(std::memory_order_relaxed);
+  snap.deallocations = deallocations_.load(std::memory_order_relaxed);
+  snap.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+  return snap;
+}
+
+void BigIntegerStats::reset() {
+  for (size_t i = 0; i < kernels_count; ++i) {
+    calls_[i].store(0, std::memory_order_relaxed);
+    nanoseconds_[i].store(0, std::memory_order_relaxed);
+    for (Counter& counter : operand_limbs_[i]) {
+      counter.store(0, std::memory_order_relaxed);
+    }
+  }
+  allocations_.store(0, std::memory_order_relaxed);
+  deallocations_.store(0, std::memory_order_relaxed);
+  allocated_bytes_.store(0, std::memory_order_relaxed);
+}
+
+void BigIntegerStats::record_allocation(size_t bytes) {
+  if constexpr (enabled) {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+}
+
+void BigIntegerStats::record_deallocation() {
+  if constexpr (enabled) {
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+std::ostream& operator<<(std::ostream& ostream,
+                         const BigIntegerStats::Snapshot& snap) {
+  static const char* names[BigIntegerStats::kernels_count] = {
+      "mul", "div", "normalize", "gcd"};
+  for (size_t i = 0; i < BigIntegerStats::kernels_count; ++i) {
+    ostream << "biginteger." << names[i] << ".calls " << snap.calls[i] << '\n';
+    ostream << "biginteger." << names[i] << ".ns " << snap.nanoseconds[i]
+            << '\n';
+    for (size_t j = 0; j < BigIntegerStats::histogram_buckets; ++j) {
+      if (snap.operand_limbs[i][j] == 0) {
+        continue;
+      }
+      ostream << "biginteger." << names[i];
+      if (j + 1 == BigIntegerStats::histogram_buckets) {
+        ostream << ".limbs_ge_" << (1ULL << (j - 1));
+      } else {
+        ostream << ".limbs_le_" << ((1ULL << j) - 1);
+      }
+      ostream << ' ' << snap.operand_limbs[i][j] << '\n';
+    }
+  }
+  ostream << "biginteger.allocations " << snap.allocations << '\n';
+  ostream << "biginteger.deallocations " << snap.deallocations << '\n';
+  ostream << "biginteger.allocated_bytes " << snap.allocated_bytes << '\n';
+  return ostream;
+}
+
+//---------------------------------BigInteger---------------------------------//
+
 class BigInteger {
  public:
   // class
@@ -29,12 +213,27 @@ class BigInteger {
   BigInteger operator++(int);
   BigInteger& operator--();
   BigInteger operator--(int);
+  // the limbs are decimal (base 10^7), so no bit-level operation below is a
+  // linear limb pass: shifts are short multiplications/divisions by 2^32 of
+  // the decimal limbs, O(n * shift / 32) for n limbs
+  BigInteger& operator<<=(size_t shift);
+  BigInteger& operator>>=(size_t shift);
+  BigInteger& operator&=(const BigInteger& other);
+  BigInteger& operator|=(const BigInteger& other);
+  BigInteger& operator^=(const BigInteger& other);
 
   // methods
   [[nodiscard]] std::string toString() const;
   void sign_reverse();
   BigInteger reverse_sign_bi();
   BigInteger absolute_value();
+  // bitwise operators and popcount convert to base 2^32 and back, O(n^2)
+  // even for operands that were just produced by another bitwise operator;
+  // bit_length is O(1) unless |x| is within 2^-20 of a power of two,
+  // test_bit(i) is O(n * i / 32)
+  [[nodiscard]] size_t bit_length() const;
+  [[nodiscard]] size_t popcount() const;
+  [[nodiscard]] bool test_bit(size_t index) const;
 
   // getters
   [[nodiscard]] Sign get_sign() const;
@@ -42,7 +241,11 @@ class BigInteger {
   [[nodiscard]] std::vector<long long> get_digits() const;
 
  private:
-  std::vector<long long> digits_;
+  using LimbAllocator =
+      std::conditional_t<BigIntegerStats::enabled,
+                         BigIntegerStats::CountingAllocator<long long>,
+                         std::allocator<long long>>;
+  std::vector<long long, LimbAllocator> digits_;
   Sign sign_ = Sign::NEUTRAL;
   static const int base_ = 10'000'000;
   static const int base_step_ = 7;
@@ -56,9 +259,18 @@ class BigInteger {
   void become_null();
   [[nodiscard]] int divide(const BigInteger& other) const;
   void insert(int digit);
-};
 
-//---------------------------------BigInteger---------------------------------//
+  // binary helpers, magnitude is stored in limbs of 2^32 (little-endian)
+  static const long long binary_base_ = 1LL << 32;
+  static const size_t binary_step_ = 32;
+  void multiply_small(long long factor);
+  long long divide_small(long long divisor);
+  [[nodiscard]] std::vector<uint32_t> to_binary() const;
+  static BigInteger from_binary(const std::vector<uint32_t>& limbs);
+  static void twos_complement(std::vector<uint32_t>& limbs);
+  template <typename Operation>
+  BigInteger& bitwise(const BigInteger& other, Operation operation);
+};
 
 //---------------------constructors----------------------//
 
@@ -271,11 +483,92 @@ BigInteger BigInteger::operator--(int) {
   return copy;
 }
 
+BigInteger& BigInteger::operator<<=(size_t shift) {
+  if (is_null()) {
+    return *this;
+  }
+  for (; shift >= binary_step_; shift -= binary_step_) {
+    multiply_small(binary_base_);
+  }
+  multiply_small(1LL << shift);
+  return *this;
+}
+
+BigInteger& BigInteger::operator>>=(size_t shift) {
+  if (is_null()) {
+    return *this;
+  }
+  bool negative = (sign_ == Sign::NEGATIVE);
+  bool lost_bits = false;
+  for (; shift >= binary_step_ && !is_null(); shift -= binary_step_) {
+    lost_bits |= (divide_small(binary_base_) != 0);
+  }
+  if (!is_null()) {
+    lost_bits |= (divide_small(1LL << shift) != 0);
+  }
+  // arithmetic shift rounds towards negative infinity
+  if (negative && lost_bits) {
+    --*this;
+  }
+  return *this;
+}
+
+BigInteger& BigInteger::operator&=(const BigInteger& other) {
+  return bitwise(other, [](uint32_t first, uint32_t second) {
+    return first & second;
+  });
+}
+
+BigInteger& BigInteger::operator|=(const BigInteger& other) {
+  return bitwise(other, [](uint32_t first, uint32_t second) {
+    return first | second;
+  });
+}
+
+BigInteger& BigInteger::operator^=(const BigInteger& other) {
+  return bitwise(other, [](uint32_t first, uint32_t second) {
+    return first ^ second;
+  });
+}
+
+BigInteger operator<<(const BigInteger& big_int, size_t shift) {
+  BigInteger copy = big_int;
+  copy <<= shift;
+  return copy;
+}
+
+BigInteger operator>>(const BigInteger& big_int, size_t shift) {
+  BigInteger copy = big_int;
+  copy >>= shift;
+  return copy;
+}
+
+BigInteger operator&(const BigInteger& bi_left, const BigInteger& bi_right) {
+  BigInteger copy = bi_left;
+  copy &= bi_right;
+  return copy;
+}
+
+BigInteger operator|(const BigInteger& bi_left, const BigInteger& bi_right) {
+  BigInteger copy = bi_left;
+  copy |= bi_right;
+  return copy;
+}
+
+BigInteger operator^(const BigInteger& bi_left, const BigInteger& bi_right) {
+  BigInteger copy = bi_left;
+  copy ^= bi_right;
+  return copy;
+}
+
 BigInteger& BigInteger::operator-=(BigInteger other) {
   return *this += other.reverse_sign_bi();
 }
 
 BigInteger& BigInteger::operator*=(const BigInteger& other) {
+  BigIntegerStats::ScopedKernel guard(
+      BigIntegerStats::Kernel::MUL,
+      std::max(digits_.size(), other.digits_.size()));
   if (*this == 0 || other == 0) {
     *this = 0;
     return *this;
@@ -305,6 +598,8 @@ BigInteger& BigInteger::operator*=(const BigInteger& other) {
 }
 
 BigInteger& BigInteger::operator/=(const BigInteger& other) {
+  BigIntegerStats::ScopedKernel guard(BigIntegerStats::Kernel::DIV,
+                                      digits_.size());
   if (get_digits_size() < other.get_digits_size() || *this == 0) {
     *this = 0;
     return *this;
@@ -402,7 +697,9 @@ BigInteger::Sign BigInteger::get_sign() const { return sign_; }
 
 size_t BigInteger::get_digits_size() const { return digits_.size(); }
 
-std::vector<long long> BigInteger::get_digits() const { return digits_; }
+std::vector<long long> BigInteger::get_digits() const {
+  return {digits_.begin(), digits_.end()};
+}
 
 //------------------------methods------------------------//
 
@@ -440,6 +737,54 @@ BigInteger BigInteger::absolute_value() {
   return copy;
 }
 
+size_t BigInteger::bit_length() const {
+  if (is_null()) {
+    return 0;
+  }
+  size_t size = digits_.size();
+  if (size <= 2) {
+    long long value = digits_[0] + (size == 2 ? digits_[1] * base_ : 0);
+    return std::bit_width(static_cast<unsigned long long>(value));
+  }
+  // |x| lies in [top, top + 1) * base^(size - 2), so the leading limbs fix
+  // the length unless that range crosses a power of two
+  double top = static_cast<double>(digits_[size - 1]) * base_ +
+               static_cast<double>(digits_[size - 2]);
+  double scale = static_cast<double>(size - 2) * std::log2(double(base_));
+  const double margin = 1e-6;
+  double low = std::floor(std::log2(top) + scale - margin);
+  double high = std::floor(std::log2(top + 1) + scale + margin);
+  if (low == high) {
+    return static_cast<size_t>(low) + 1;
+  }
+  std::vector<uint32_t> limbs = to_binary();
+  return (limbs.size() - 1) * binary_step_ + std::bit_width(limbs.back());
+}
+
+size_t BigInteger::popcount() const {
+  size_t count = 0;
+  for (uint32_t limb : to_binary()) {
+    count += std::popcount(limb);
+  }
+  return count;
+}
+
+bool BigInteger::test_bit(size_t index) const {
+  // bit i of -m in two's complement is the inverted bit i of m - 1
+  bool negative = (sign_ == Sign::NEGATIVE);
+  BigInteger copy = *this;
+  if (negative) {
+    copy.sign_ = Sign::POSITIVE;
+    --copy;
+  }
+  for (; index >= binary_step_ && !copy.is_null(); index -= binary_step_) {
+    copy.divide_small(binary_base_);
+  }
+  bool bit =
+      !copy.is_null() && ((copy.divide_small(binary_base_) >> index) & 1);
+  return bit != negative;
+}
+
 BigInteger BigInteger::reverse_sign_bi() {
   sign_reverse();
   return *this;
@@ -484,6 +829,8 @@ void BigInteger::delete_first_nulls() {
 }
 
 void BigInteger::normalize() {
+  BigIntegerStats::ScopedKernel guard(BigIntegerStats::Kernel::NORMALIZE,
+                                      digits_.size());
   long long carry;
   for (size_t i = 0; i < digits_.size(); ++i) {
     if (digits_[i] >= base_) {
@@ -512,8 +859,112 @@ int BigInteger::divide(const BigInteger& other) const {
 }
 
 void BigInteger::insert(int digit) {
-  *this *= base_;
-  digits_[0] = digit;
+  if (is_null() || digits_.empty()) {
+    digits_.assign(1, digit);
+    sign_ = (digit == 0) ? Sign::NEUTRAL : Sign::POSITIVE;
+    return;
+  }
+  digits_.insert(digits_.begin(), digit);
+}
+
+void BigInteger::multiply_small(long long factor) {
+  long long carry = 0;
+  for (long long& digit : digits_) {
+    digit = digit * factor + carry;
+    carry = digit / base_;
+    digit %= base_;
+  }
+  while (carry > 0) {
+    digits_.push_back(carry % base_);
+    carry /= base_;
+  }
+}
+
+long long BigInteger::divide_small(long long divisor) {
+  long long remainder = 0;
+  for (size_t i = digits_.size(); i > 0; --i) {
+    long long current = digits_[i - 1] + remainder * base_;
+    digits_[i - 1] = current / divisor;
+    remainder = current % divisor;
+  }
+  delete_first_nulls();
+  if (digits_.size() == 1 && digits_[0] == 0) {
+    sign_ = Sign::NEUTRAL;
+  }
+  return remainder;
+}
+
+std::vector<uint32_t> BigInteger::to_binary() const {
+  std::vector<uint32_t> limbs;
+  if (is_null()) {
+    return limbs;
+  }
+  BigInteger copy = *this;
+  copy.sign_ = Sign::POSITIVE;
+  while (!copy.is_null()) {
+    limbs.push_back(static_cast<uint32_t>(copy.divide_small(binary_base_)));
+  }
+  return limbs;
+}
+
+BigInteger BigInteger::from_binary(const std::vector<uint32_t>& limbs) {
+  BigInteger res = 0;
+  for (size_t i = limbs.size(); i > 0; --i) {
+    res.multiply_small(binary_base_);
+    long long carry = limbs[i - 1];
+    for (size_t j = 0; carry > 0; ++j) {
+      if (j == res.digits_.size()) {
+        res.digits_.push_back(0);
+      }
+      res.digits_[j] += carry;
+      carry = res.digits_[j] / base_;
+      res.digits_[j] %= base_;
+    }
+  }
+  res.delete_first_nulls();
+  res.sign_ = (res.digits_.size() == 1 && res.digits_[0] == 0)
+                  ? Sign::NEUTRAL
+                  : Sign::POSITIVE;
+  return res;
+}
+
+void BigInteger::twos_complement(std::vector<uint32_t>& limbs) {
+  bool carry = true;
+  for (uint32_t& limb : limbs) {
+    limb = ~limb + static_cast<uint32_t>(carry);
+    carry = carry && limb == 0;
+  }
+}
+
+template <typename Operation>
+BigInteger& BigInteger::bitwise(const BigInteger& other,
+                                Operation operation) {
+  std::vector<uint32_t> first = to_binary();
+  std::vector<uint32_t> second = other.to_binary();
+  size_t size = std::max(first.size(), second.size()) + 1;
+  bool first_negative = (sign_ == Sign::NEGATIVE);
+  bool second_negative = (other.sign_ == Sign::NEGATIVE);
+  first.resize(size, 0);
+  second.resize(size, 0);
+  if (first_negative) {
+    twos_complement(first);
+  }
+  if (second_negative) {
+    twos_complement(second);
+  }
+  for (size_t i = 0; i < size; ++i) {
+    first[i] = operation(first[i], second[i]);
+  }
+  bool negative = operation(first_negative ? ~0u : 0u,
+                            second_negative ? ~0u : 0u) != 0;
+  if (negative) {
+    twos_complement(first);
+  }
+  *this = from_binary(first);
+  if (negative) {
+    sign_ = Sign::NEGATIVE;
+  }
+  return *this;
 }
 
 //----------------------------------Rational----------------------------------//
@@ -727,6 +1178,9 @@ std::string Rational::asDecimal(size_t precision) const {
 }
 
 BigInteger Rational::gcd(BigInteger first, BigInteger second) {
+  BigIntegerStats::ScopedKernel guard(
+      BigIntegerStats::Kernel::GCD,
+      std::max(first.get_digits_size(), second.get_digits_size()));
   if (first == 0 || second == 0) {
     return 0;
   }
@@ -20,6 +20,74 @@ void basic_test_bi() {
   assert(c + d == 408);
 }
 
+void bit_operations_test_bi() {
+  BigInteger big("42391158275216203514294433201");
+  BigInteger neg_big("-42391158275216203514294433201");
+  assert((1_bi << 100) == BigInteger("1267650600228229401496703205376"));
+  assert((big >> 37) == BigInteger("308436270826614079"));
+  assert(((1_bi << 100) >> 100) == 1);
+  assert((-5_bi >> 1) == -3);
+  assert((neg_big >> 40) == BigInteger("-38554533853326760"));
+  assert((neg_big >> 200) == -1);
+  assert((5_bi >> 3) == 0);
+  assert((-12_bi & 7) == 4);
+  assert((-12_bi | 7) == -9);
+  assert((-12_bi ^ 7) == -13);
+  BigInteger first("717897987691852588770249");
+  BigInteger second("931322574615478515625");
+  assert((first & second) == BigInteger("5814238382973363081"));
+  assert((first ^ -second) == BigInteger("-718817681789702120559714"));
+  assert((first ^ first) == 0);
+  assert(big.bit_length() == 96);
+  assert(big.popcount() == 56);
+  assert(BigInteger(0).bit_length() == 0);
+  assert(neg_big.test_bit(0) && neg_big.test_bit(1) && !neg_big.test_bit(95));
+  assert(neg_big.test_bit(96) && neg_big.test_bit(200));
+  assert(big.test_bit(0) && !big.test_bit(200));
+  for (size_t shift : {24, 47, 49, 100, 333}) {
+    BigInteger power = 1_bi << shift;
+    assert(power.bit_length() == shift + 1);
+    assert((power - 1).bit_length() == shift);
+    assert(power.test_bit(shift) && !power.test_bit(shift - 1));
+    assert((-power).test_bit(shift) && !(-power).test_bit(shift - 1));
+    assert((-power + 1).test_bit(0) && !(-power + 1).test_bit(1));
+    assert((-power - 1).test_bit(shift + 1));
+  }
+  assert(BigInteger("70000007") / 7 == 10000001);
+}
+
+void stats_test_bi() {
+  BigIntegerStats::reset();
+  BigInteger a("123456789012345678901234567890");
+  BigInteger b = a * a;
+  b /= 12345;
+  Rational::gcd(a, b);
+  BigIntegerStats::Snapshot snap = BigIntegerStats::snapshot();
+  if constexpr (BigIntegerStats::enabled) {
+    using Kernel = BigIntegerStats::Kernel;
+    assert(snap.calls[static_cast<size_t>(Kernel::MUL)] > 0);
+    assert(snap.calls[static_cast<size_t>(Kernel::DIV)] > 0);
+    assert(snap.calls[static_cast<size_t>(Kernel::NORMALIZE)] > 0);
+    assert(snap.calls[static_cast<size_t>(Kernel::GCD)] == 1);
+    assert(snap.operand_limbs[static_cast<size_t>(Kernel::GCD)][4] == 1);
+    assert(snap.allocations > 0 && snap.allocated_bytes > 0);
+    std::ostringstream oss;
+    oss << snap;
+    assert(oss.str().find("biginteger.gcd.calls 1") != std::string::npos);
+    assert(oss.str().find("biginteger.gcd.limbs_le_15 1") != std::string::npos);
+    BigIntegerStats::Snapshot open_bucket;
+    open_bucket.operand_limbs[0][BigIntegerStats::histogram_buckets - 1] = 1;
+    std::ostringstream open_oss;
+    open_oss << open_bucket;
+    assert(open_oss.str().find("biginteger.mul.limbs_ge_4194304 1") !=
+           std::string::npos);
+  } else {
+    assert(snap.calls[0] == 0 && snap.allocations == 0);
+  }
+  BigIntegerStats::reset();
+  assert(BigIntegerStats::snapshot().allocations == 0);
+}
+
 void basic_test_rational() {
   Rational a(15);
   a /= 20;
@@ -33,5 +101,7 @@ void basic_test_rational() {
 
 int main() {
   basic_test_bi();
+  bit_operations_test_bi();
+  stats_test_bi();
   basic_test_rational();
 }
\ No newline at end of file
@@ -1,11 +1,24 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstdint>
 #include <exception>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <set>
 #include <stack>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 template <typename T>
 concept RegularExpr = requires(T first, T second, size_t i) {
   first + second;
@@ -151,60 +164,108 @@ RegularExpression::iterator RegularExpression::end() const {
   return iter;
 }
 
+// Set of automaton states as a bitset, the unit of subset construction and
+// of the Thompson simulation
+class StateSet {
+ private:
+  std::vector<uint64_t> words_;
+
+ public:
+  StateSet() = default;
+  explicit StateSet(size_t states_count) : words_((states_count + 63) / 64) {}
+  void insert(size_t state) { words_[state / 64] |= uint64_t(1) << state % 64; }
+  bool contains(size_t state) const {
+    return (words_[state / 64] >> state % 64 & 1) != 0;
+  }
+  bool empty() const {
+    return std::all_of(words_.begin(), words_.end(),
+                       [](uint64_t word) { return word == 0; });
+  }
+  void clear() { std::fill(words_.begin(), words_.end(), 0); }
+  StateSet& operator|=(const StateSet& other) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      words_[i] |= other.words_[i];
+    }
+    return *this;
+  }
+  // calls visit(state) for every state in the set, in increasing order
+  template <typename Visit>
+  void for_each(Visit visit) const {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      for (uint64_t word = words_[i]; word != 0; word &= word - 1) {
+        visit(i * 64 + std::countr_zero(word));
+      }
+    }
+  }
+  bool operator==(const StateSet& other) const = default;
+  auto operator<=>(const StateSet& other) const = default;
+};
+
+template <RegularExpr Reg>
+class DFA;
+
+template <RegularExpr Reg>
+class ThompsonMatcher;
+
+// Thompson automaton of a regular expression. States and edges live in two
+// flat arrays and refer to each other by index, so an NFA is a plain value:
+// copies are deep, nothing leaks, and building one allocates only when the
+// arrays grow.
 template <RegularExpr Reg = RegularExpression>
 class NFA {
  private:
-  struct Edge;
+  template <RegularExpr>
+  friend class DFA;
+  template <RegularExpr>
+  friend class ThompsonMatcher;
+
+  static constexpr uint32_t kNone = UINT32_MAX;
+
   struct Node {
-   private:
-    std::vector<Edge*> transitions;
+    // outgoing edges form a list through Edge::next in insertion order
+    uint32_t first_edge = kNone;
+    uint32_t last_edge = kNone;
     bool is_terminal = false;
     bool is_start = false;
+    // fresh start state of an iteration, its first edge enters the operand
+    bool is_iteration_entry = false;
     long long max_suf_length = 0;
     int depth = 0;
-
-   public:
-    Node() = default;
-    ~Node() = default;
-    void add_to_transitions(Edge* edge) noexcept {
-      transitions.push_back(edge);
-    }
-    [[nodiscard(
-        "You are ignoring the vector of transitions")]] std::vector<Edge*>&
-    get_transitions() noexcept {
-      return transitions;
-    }
-    void set_terminal(bool status) noexcept { is_terminal = status; }
-    void set_start(bool status) noexcept { is_start = status; }
-    bool get_terminal() noexcept { return is_terminal; }
-    void set_max_suf_length(long long length) noexcept {
-      max_suf_length = length;
-    }
-    size_t get_max_suf_length() noexcept { return max_suf_length; }
-    void set_depth(int new_depth) noexcept { depth = new_depth; }
-    int get_depth() noexcept { return depth; }
-    Node* get_first_transition() { return transitions[0]->get_to(); }
   };
 
   struct Edge {
-   private:
-    Node* from = nullptr;
-    Node* to = nullptr;
+    uint32_t to = 0;
+    uint32_t next = kNone;
+    // '\0' marks an epsilon edge
     char symbol = '\0';
-
-   public:
-    Edge() = default;
-    Edge(Node* from, Node* to, char symbol);
-    ~Edge() = default;
-    Node* get_from();
-    Node* get_to();
-    char get_symbol();
   };
 
-  Node* start = nullptr;
-  Node* terminal_vertex = nullptr;
+  std::vector<Node> nodes;
+  std::vector<Edge> edges;
+  uint32_t start = 0;
+  uint32_t terminal_vertex = 0;
   char needed_letter = '\0';
 
+  uint32_t add_node();
+  void add_edge(uint32_t from, uint32_t to, char symbol);
+  // appends the states and edges of other, returns the index its states
+  // start from
+  uint32_t absorb(const NFA& other);
+  const Edge& first_edge(uint32_t node) const {
+    return edges[nodes[node].first_edge];
+  }
+
+  // Adjacency lists of the automaton for the matchers built from it, edges
+  // are (symbol, target) pairs
+  struct StateGraph {
+    std::vector<std::vector<std::pair<char, size_t>>> edges;
+    // closures[state] holds every state reachable by epsilon edges alone
+    std::vector<StateSet> closures;
+    size_t start = 0;
+    size_t terminal = 0;
+  };
+  StateGraph state_graph() const;
+
  public:
   NFA() = default;
   ~NFA() = default;
@@ -213,11 +274,15 @@ class NFA {
   void concatenate(const NFA& other);
   void Kleene_iteration();
   void combine(const NFA& other);
+  size_t states_count() const { return nodes.size(); }
   bool check_suf(int k) {
     if (needed_letter == '1') {
-      return terminal_vertex == start;
+      // the outermost operation is an iteration: its entry skips straight
+      // to the terminal
+      return nodes[start].is_iteration_entry &&
+             edges[nodes[start].last_edge].to == terminal_vertex;
     }
-    return terminal_vertex->get_max_suf_length() >= k;
+    return nodes[terminal_vertex].max_suf_length >= k;
   }
   void printing_answer(int k) {
     bool containment = check_suf(k);
@@ -226,39 +291,57 @@ class NFA {
 };
 
 template <RegularExpr Reg>
-NFA<Reg>::Edge::Edge(NFA::Node* from, NFA::Node* to, char symbol)
-    : from(from), to(to), symbol(symbol) {}
-
-template <RegularExpr Reg>
-NFA<Reg>::Node* NFA<Reg>::Edge::get_from() {
-  return from;
+uint32_t NFA<Reg>::add_node() {
+  nodes.emplace_back();
+  return static_cast<uint32_t>(nodes.size() - 1);
 }
 
 template <RegularExpr Reg>
-NFA<Reg>::Node* NFA<Reg>::Edge::get_to() {
-  return to;
+void NFA<Reg>::add_edge(uint32_t from, uint32_t to, char symbol) {
+  uint32_t index = static_cast<uint32_t>(edges.size());
+  edges.push_back(Edge{to, kNone, symbol});
+  Node& node = nodes[from];
+  if (node.last_edge == kNone) {
+    node.first_edge = index;
+  } else {
+    edges[node.last_edge].next = index;
+  }
+  node.last_edge = index;
 }
 
 template <RegularExpr Reg>
-char NFA<Reg>::Edge::get_symbol() {
-  return symbol;
+uint32_t NFA<Reg>::absorb(const NFA<Reg>& other) {
+  uint32_t node_shift = static_cast<uint32_t>(nodes.size());
+  uint32_t edge_shift = static_cast<uint32_t>(edges.size());
+  auto shift = [](uint32_t index, uint32_t by) {
+    return index == kNone ? kNone : index + by;
+  };
+  for (Node node : other.nodes) {
+    node.first_edge = shift(node.first_edge, edge_shift);
+    node.last_edge = shift(node.last_edge, edge_shift);
+    nodes.push_back(node);
+  }
+  for (Edge edge : other.edges) {
+    edge.to += node_shift;
+    edge.next = shift(edge.next, edge_shift);
+    edges.push_back(edge);
+  }
+  return node_shift;
 }
 
 template <RegularExpr Reg>
 NFA<Reg>::NFA(char letter, char letter_find) {
   needed_letter = letter_find;
-  Node* node = new Node();
-  start = node;
-  node->set_start(true);
-  Node* new_node = new Node();
-  Edge* edge = new Edge(node, new_node, letter);
-  node->add_to_transitions(edge);
-  new_node->set_terminal(true);
-  terminal_vertex = new_node;
+  start = add_node();
+  nodes[start].is_start = true;
+  terminal_vertex = add_node();
+  add_edge(start, terminal_vertex, letter);
+  Node& new_node = nodes[terminal_vertex];
+  new_node.is_terminal = true;
   if (letter == needed_letter) {
-    new_node->set_max_suf_length(1);
+    new_node.max_suf_length = 1;
   }
-  new_node->set_depth(1);
+  new_node.depth = 1;
 }
 
 template <RegularExpr Reg>
@@ -276,89 +359,656 @@ NFA<Reg>::NFA(const Reg& regular_expression, char letter_find) {
       continue;
     }
     if (letter == '.') {
-      NFA<Reg> second = stack.top();
-      stack.pop();
-      NFA<Reg> first = stack.top();
+      NFA<Reg> second = std::move(stack.top());
       stack.pop();
-      first.concatenate(second);
-      stack.push(first);
+      stack.top().concatenate(second);
       continue;
     }
     if (letter == '+') {
-      NFA<Reg> second = stack.top();
-      stack.pop();
-      NFA<Reg> first = stack.top();
+      NFA<Reg> second = std::move(stack.top());
       stack.pop();
-      first.combine(second);
-      stack.push(first);
+      stack.top().combine(second);
       continue;
     }
     if (letter == '*') {
-      NFA<Reg> nfa = stack.top();
-      stack.pop();
-      nfa.Kleene_iteration();
-      stack.push(nfa);
+      stack.top().Kleene_iteration();
       continue;
     }
     throw std::invalid_argument("Check your correctness-checker function.");
   }
-  *this = stack.top();
+  *this = std::move(stack.top());
   stack.pop();
 }
 
 template <RegularExpr Reg>
 void NFA<Reg>::concatenate(const NFA<Reg>& other) {
-  other.start->set_start(false);
-  Edge* edge = new Edge(terminal_vertex, other.start, '\0');
-  terminal_vertex->add_to_transitions(edge);
-  terminal_vertex->set_terminal(false);
-  other.start->set_max_suf_length(terminal_vertex->get_max_suf_length());
-  if (other.start->get_transitions()[0]->get_symbol() == needed_letter) {
-    other.start->get_first_transition()->set_max_suf_length(
-        other.start->get_max_suf_length() + 1);
+  uint32_t shift = absorb(other);
+  uint32_t other_start = other.start + shift;
+  uint32_t other_terminal = other.terminal_vertex + shift;
+  nodes[other_start].is_start = false;
+  add_edge(terminal_vertex, other_start, '\0');
+  nodes[terminal_vertex].is_terminal = false;
+  nodes[other_start].max_suf_length = nodes[terminal_vertex].max_suf_length;
+  // suffix lengths count the first letter of other, which an iteration
+  // reaches through its entry state
+  uint32_t entry = other_start;
+  while (nodes[entry].is_iteration_entry) {
+    entry = first_edge(entry).to;
+  }
+  const Edge& first = first_edge(entry);
+  Node& first_transition = nodes[first.to];
+  if (first.symbol == needed_letter) {
+    first_transition.max_suf_length = nodes[other_start].max_suf_length + 1;
   } else {
-    other.start->get_first_transition()->set_max_suf_length(
-        other.start->get_max_suf_length());
-  }
-  other.terminal_vertex->set_max_suf_length(
-      other.start->get_first_transition()->get_max_suf_length());
-  other.start->set_depth(terminal_vertex->get_depth());
-  terminal_vertex = other.terminal_vertex;
-  Node* first_transition = other.start->get_first_transition();
-  if (other.start->get_transitions()[0]->get_symbol() != '\0') {
-    first_transition->set_depth(other.start->get_depth() + 1);
+    first_transition.max_suf_length = nodes[other_start].max_suf_length;
+  }
+  nodes[other_terminal].max_suf_length = first_transition.max_suf_length;
+  nodes[other_start].depth = nodes[terminal_vertex].depth;
+  terminal_vertex = other_terminal;
+  if (first.symbol != '\0') {
+    first_transition.depth = nodes[other_start].depth + 1;
   } else {
-    first_transition->set_depth(other.start->get_depth());
+    first_transition.depth = nodes[other_start].depth;
   }
-  terminal_vertex->set_depth(first_transition->get_depth());
+  nodes[terminal_vertex].depth = first_transition.depth;
 }
 
 template <RegularExpr Reg>
 void NFA<Reg>::combine(const NFA<Reg>& other) {
-  Node* node = new Node();
-  Edge* first_edge = new Edge(node, start, '\0');
-  start->set_start(false);
-  Edge* second_edge = new Edge(node, other.start, '\0');
-  other.start->set_start(false);
-  Node* old_start = start;
-  start = node;
-  node->set_start(true);
-  start->add_to_transitions(first_edge);
-  start->add_to_transitions(second_edge);
-  Edge* edge_to_term = new Edge(other.terminal_vertex, terminal_vertex, '\0');
-  other.terminal_vertex->set_terminal(false);
-  other.terminal_vertex->add_to_transitions(edge_to_term);
-  start->set_depth(old_start->get_depth());
+  uint32_t shift = absorb(other);
+  uint32_t other_start = other.start + shift;
+  uint32_t other_terminal = other.terminal_vertex + shift;
+  uint32_t old_start = start;
+  start = add_node();
+  nodes[start].is_start = true;
+  nodes[old_start].is_start = false;
+  nodes[other_start].is_start = false;
+  add_edge(start, old_start, '\0');
+  add_edge(start, other_start, '\0');
+  // Both branches end in a fresh terminal: if one branch led into the
+  // terminal of the other and that were the start of an iteration, words of
+  // the first branch could continue with it
+  uint32_t new_terminal = add_node();
+  for (uint32_t old_terminal : {terminal_vertex, other_terminal}) {
+    add_edge(old_terminal, new_terminal, '\0');
+    nodes[old_terminal].is_terminal = false;
+  }
+  nodes[new_terminal].is_terminal = true;
+  nodes[new_terminal].max_suf_length = nodes[terminal_vertex].max_suf_length;
+  nodes[new_terminal].depth = nodes[terminal_vertex].depth;
+  terminal_vertex = new_terminal;
+  nodes[start].depth = nodes[old_start].depth;
 }
 
 template <RegularExpr Reg>
 void NFA<Reg>::Kleene_iteration() {
-  Edge* edge = new Edge(terminal_vertex, start, '\0');
-  terminal_vertex->add_to_transitions(edge);
-  terminal_vertex->set_terminal(false);
-  if (terminal_vertex->get_depth() == terminal_vertex->get_max_suf_length()) {
-    start->set_max_suf_length(INT32_MAX);
-  }
-  terminal_vertex = start;
-  start->set_terminal(true);
-}
\ No newline at end of file
+  // Thompson's construction: the loop goes from the old terminal back to the
+  // old start, and both ends get fresh states. Reusing the old start as the
+  // terminal would accept words stopping inside a nested loop, e.g. "ab" for
+  // b*a.*
+  uint32_t old_start = start;
+  uint32_t old_terminal = terminal_vertex;
+  start = add_node();
+  terminal_vertex = add_node();
+  add_edge(start, old_start, '\0');
+  add_edge(old_terminal, old_start, '\0');
+  add_edge(old_terminal, terminal_vertex, '\0');
+  add_edge(start, terminal_vertex, '\0');
+  nodes[old_start].is_start = false;
+  nodes[old_terminal].is_terminal = false;
+  nodes[start].is_start = true;
+  nodes[start].is_iteration_entry = true;
+  nodes[terminal_vertex].is_terminal = true;
+  long long max_suf_length = nodes[old_start].max_suf_length;
+  if (nodes[old_terminal].depth == nodes[old_terminal].max_suf_length) {
+    max_suf_length = INT32_MAX;
+  }
+  for (uint32_t node : {start, terminal_vertex}) {
+    nodes[node].max_suf_length = max_suf_length;
+    nodes[node].depth = nodes[old_start].depth;
+  }
+}
+
+template <RegularExpr Reg>
+typename NFA<Reg>::StateGraph NFA<Reg>::state_graph() const {
+  StateGraph graph;
+  graph.edges.resize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    for (uint32_t edge = nodes[i].first_edge; edge != kNone;
+         edge = edges[edge].next) {
+      graph.edges[i].emplace_back(edges[edge].symbol, edges[edge].to);
+    }
+  }
+  graph.start = start;
+  graph.terminal = terminal_vertex;
+  graph.closures.assign(nodes.size(), StateSet(nodes.size()));
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    StateSet& closure = graph.closures[i];
+    std::vector<size_t> pending = {i};
+    closure.insert(i);
+    while (!pending.empty()) {
+      size_t state = pending.back();
+      pending.pop_back();
+      for (auto [symbol, to] : graph.edges[state]) {
+        if (symbol == '\0' && !closure.contains(to)) {
+          closure.insert(to);
+          pending.push_back(to);
+        }
+      }
+    }
+  }
+  return graph;
+}
+
+// Deterministic automaton built from NFA by subset construction and
+// minimized with Hopcroft's algorithm. Transitions are a dense table with a
+// row of kAlphabetSize entries per state, bytes outside the alphabet of the
+// expression lead to a dead state, so match() does one lookup per byte.
+template <RegularExpr Reg = RegularExpression>
+class DFA {
+ private:
+  static constexpr size_t kAlphabetSize = 256;
+
+  // transitions_[state + byte] is the next state, every state is stored as
+  // the offset of its row
+  std::vector<uint32_t> transitions_;
+  // indexed by row number
+  std::vector<bool> accepting_;
+  uint32_t start_ = 0;
+
+  // Hopcroft's partition refinement over the complete automaton given by
+  // delta[state][letter]; returns the block of every state
+  static std::vector<uint32_t> minimize(
+      const std::vector<std::vector<uint32_t>>& delta,
+      const std::vector<bool>& accepting, size_t& blocks_count);
+
+ public:
+  explicit DFA(const Reg& regular_expression);
+  explicit DFA(const NFA<Reg>& nfa);
+  size_t states_count() const { return accepting_.size(); }
+  // whether the whole word belongs to the language
+  bool match(std::string_view word) const;
+};
+
+template <RegularExpr Reg>
+DFA<Reg>::DFA(const Reg& regular_expression)
+    : DFA(NFA<Reg>(regular_expression, '\0')) {}
+
+template <RegularExpr Reg>
+DFA<Reg>::DFA(const NFA<Reg>& nfa) {
+  auto graph = nfa.state_graph();
+  size_t nfa_states = graph.edges.size();
+  std::vector<char> letters;
+  for (const auto& edges : graph.edges) {
+    for (auto [symbol, to] : edges) {
+      if (symbol != '\0' &&
+          std::find(letters.begin(), letters.end(), symbol) == letters.end()) {
+        letters.push_back(symbol);
+      }
+    }
+  }
+
+  // subset construction, subset 0 is the empty one and serves as dead state
+  std::vector<StateSet> subsets = {StateSet(nfa_states),
+                                   graph.closures[graph.start]};
+  std::map<StateSet, uint32_t> numbers = {{subsets[0], 0}, {subsets[1], 1}};
+  std::vector<std::vector<uint32_t>> delta;
+  for (size_t current = 0; current < subsets.size(); ++current) {
+    delta.emplace_back(letters.size());
+    for (size_t letter = 0; letter < letters.size(); ++letter) {
+      StateSet next(nfa_states);
+      subsets[current].for_each([&](size_t state) {
+        for (auto [symbol, to] : graph.edges[state]) {
+          if (symbol == letters[letter]) {
+            next |= graph.closures[to];
+          }
+        }
+      });
+      auto [it, inserted] =
+          numbers.emplace(next, static_cast<uint32_t>(subsets.size()));
+      if (inserted) {
+        subsets.push_back(std::move(next));
+      }
+      delta[current][letter] = it->second;
+    }
+  }
+  std::vector<bool> accepting(subsets.size());
+  for (size_t i = 0; i < subsets.size(); ++i) {
+    accepting[i] = subsets[i].contains(graph.terminal);
+  }
+
+  size_t blocks_count = 0;
+  std::vector<uint32_t> block_of = minimize(delta, accepting, blocks_count);
+  uint32_t dead_row = block_of[0] * kAlphabetSize;
+  transitions_.assign(blocks_count * kAlphabetSize, dead_row);
+  accepting_.assign(blocks_count, false);
+  for (size_t state = 0; state < subsets.size(); ++state) {
+    size_t row = block_of[state] * kAlphabetSize;
+    accepting_[block_of[state]] = accepting[state];
+    for (size_t letter = 0; letter < letters.size(); ++letter) {
+      transitions_[row + static_cast<unsigned char>(letters[letter])] =
+          block_of[delta[state][letter]] * kAlphabetSize;
+    }
+  }
+  start_ = block_of[1] * kAlphabetSize;
+}
+
+template <RegularExpr Reg>
+std::vector<uint32_t> DFA<Reg>::minimize(
+    const std::vector<std::vector<uint32_t>>& delta,
+    const std::vector<bool>& accepting, size_t& blocks_count) {
+  size_t states = delta.size();
+  size_t letters = delta[0].size();
+  // inverse[letter][state] lists the states that move to state by letter
+  std::vector<std::vector<std::vector<uint32_t>>> inverse(
+      letters, std::vector<std::vector<uint32_t>>(states));
+  for (uint32_t state = 0; state < states; ++state) {
+    for (size_t letter = 0; letter < letters; ++letter) {
+      inverse[letter][delta[state][letter]].push_back(state);
+    }
+  }
+
+  std::vector<std::vector<uint32_t>> blocks;
+  std::vector<uint32_t> block_of(states);
+  for (bool kind : {false, true}) {
+    std::vector<uint32_t> block;
+    for (uint32_t state = 0; state < states; ++state) {
+      if (accepting[state] == kind) {
+        block_of[state] = static_cast<uint32_t>(blocks.size());
+        block.push_back(state);
+      }
+    }
+    if (!block.empty()) {
+      blocks.push_back(std::move(block));
+    }
+  }
+
+  std::vector<uint32_t> work;
+  std::vector<bool> in_work(blocks.size(), true);
+  for (uint32_t block = 0; block < blocks.size(); ++block) {
+    work.push_back(block);
+  }
+  std::vector<bool> marked(states, false);
+  std::vector<size_t> hits(blocks.size(), 0);
+  while (!work.empty()) {
+    uint32_t splitter = work.back();
+    work.pop_back();
+    in_work[splitter] = false;
+    std::vector<uint32_t> members = blocks[splitter];
+    for (size_t letter = 0; letter < letters; ++letter) {
+      std::vector<uint32_t> predecessors;
+      std::vector<uint32_t> touched;
+      for (uint32_t state : members) {
+        for (uint32_t from : inverse[letter][state]) {
+          if (!marked[from]) {
+            marked[from] = true;
+            predecessors.push_back(from);
+            if (hits[block_of[from]]++ == 0) {
+              touched.push_back(block_of[from]);
+            }
+          }
+        }
+      }
+      // every block entered only partly is split into what moves into the
+      // splitter by letter and the rest
+      for (uint32_t block : touched) {
+        if (hits[block] < blocks[block].size()) {
+          std::vector<uint32_t> inside;
+          std::vector<uint32_t> outside;
+          for (uint32_t state : blocks[block]) {
+            (marked[state] ? inside : outside).push_back(state);
+          }
+          uint32_t new_block = static_cast<uint32_t>(blocks.size());
+          for (uint32_t state : inside) {
+            block_of[state] = new_block;
+          }
+          blocks[block] = std::move(outside);
+          blocks.push_back(std::move(inside));
+          in_work.push_back(false);
+          hits.push_back(0);
+          // it is enough to refine by the smaller half when the block
+          // itself is not waiting in the work list
+          uint32_t next_splitter =
+              (in_work[block] ||
+               blocks[new_block].size() <= blocks[block].size())
+                  ? new_block
+                  : block;
+          work.push_back(next_splitter);
+          in_work[next_splitter] = true;
+        }
+        hits[block] = 0;
+      }
+      for (uint32_t state : predecessors) {
+        marked[state] = false;
+      }
+    }
+  }
+  blocks_count = blocks.size();
+  return block_of;
+}
+
+template <RegularExpr Reg>
+bool DFA<Reg>::match(std::string_view word) const {
+  uint32_t state = start_;
+  for (unsigned char byte : word) {
+    state = transitions_[state + byte];
+  }
+  return accepting_[state / kAlphabetSize];
+}
+
+// Runs the NFA itself on the input, keeping the set of states it may be in
+// as a bitset. Epsilon closures are folded into the per-letter steps in
+// advance, so every byte costs at most one union per active state: time is
+// O(|text| * states * states / 64) whatever the pattern, unlike
+// backtracking, and no states are built on the fly, unlike DFA.
+template <RegularExpr Reg = RegularExpression>
+class ThompsonMatcher {
+ private:
+  static constexpr size_t kAlphabetSize = 256;
+
+  // letter_of_[byte] is 1 + the index of byte in steps_, 0 if the
+  // expression never reads it
+  std::array<uint8_t, kAlphabetSize> letter_of_{};
+  // steps_[letter][state] is the closure of the states state moves to
+  std::vector<std::vector<StateSet>> steps_;
+  StateSet start_;
+  size_t terminal_ = 0;
+
+  void advance(const StateSet& current, StateSet& next,
+               unsigned char byte) const;
+
+ public:
+  explicit ThompsonMatcher(const Reg& regular_expression);
+  explicit ThompsonMatcher(const NFA<Reg>& nfa);
+  // whether the whole word belongs to the language
+  bool full_match(std::string_view word) const;
+  // whether some substring of text belongs to the language
+  bool search(std::string_view text) const;
+};
+
+template <RegularExpr Reg>
+ThompsonMatcher<Reg>::ThompsonMatcher(const Reg& regular_expression)
+    : ThompsonMatcher(NFA<Reg>(regular_expression, '\0')) {}
+
+template <RegularExpr Reg>
+ThompsonMatcher<Reg>::ThompsonMatcher(const NFA<Reg>& nfa) {
+  auto graph = nfa.state_graph();
+  size_t states = graph.edges.size();
+  for (size_t state = 0; state < states; ++state) {
+    for (auto [symbol, to] : graph.edges[state]) {
+      if (symbol == '\0') {
+        continue;
+      }
+      uint8_t& letter = letter_of_[static_cast<unsigned char>(symbol)];
+      if (letter == 0) {
+        steps_.emplace_back(states, StateSet(states));
+        letter = static_cast<uint8_t>(steps_.size());
+      }
+      steps_[letter - 1][state] |= graph.closures[to];
+    }
+  }
+  start_ = graph.closures[graph.start];
+  terminal_ = graph.terminal;
+}
+
+template <RegularExpr Reg>
+void ThompsonMatcher<Reg>::advance(const StateSet& current, StateSet& next,
+                                   unsigned char byte) const {
+  next.clear();
+  if (letter_of_[byte] == 0) {
+    return;
+  }
+  const std::vector<StateSet>& step = steps_[letter_of_[byte] - 1];
+  current.for_each([&](size_t state) { next |= step[state]; });
+}
+
+template <RegularExpr Reg>
+bool ThompsonMatcher<Reg>::full_match(std::string_view word) const {
+  StateSet current = start_;
+  StateSet next = start_;
+  for (unsigned char byte : word) {
+    advance(current, next, byte);
+    if (next.empty()) {
+      return false;
+    }
+    std::swap(current, next);
+  }
+  return current.contains(terminal_);
+}
+
+// The start closure joins the set before every byte, so a match may begin
+// at any position; the first state set holding the terminal ends the scan
+template <RegularExpr Reg>
+bool ThompsonMatcher<Reg>::search(std::string_view text) const {
+  StateSet current = start_;
+  StateSet next = start_;
+  for (unsigned char byte : text) {
+    if (current.contains(terminal_)) {
+      return true;
+    }
+    advance(current, next, byte);
+    next |= start_;
+    std::swap(current, next);
+  }
+  return current.contains(terminal_);
+}
+
+// Bit-parallel matcher over the Glushkov automaton of the expression: one
+// state per letter occurrence (position), no epsilon edges, and every edge
+// into a position reads that position's letter. The state set fits in one
+// machine word for up to 64 positions and in four for up to 256, so a byte
+// costs a few table lookups and bitwise operations:
+//
+//   states = follow(states) & positions_of[byte]
+//
+// follow() is read from tables indexed by each byte of the state set. With
+// AVX2 enabled at compile time the four-word sets are handled as one
+// 256-bit register.
+template <RegularExpr Reg = RegularExpression>
+class GlushkovMatcher {
+ public:
+  static constexpr size_t kMaxPositions = 256;
+
+ private:
+  static constexpr size_t kAlphabetSize = 256;
+  static constexpr size_t kMaxWords = kMaxPositions / 64;
+  using Positions = std::array<uint64_t, kMaxWords>;
+
+  size_t positions_count_ = 0;
+  // 1 or kMaxWords, the stride of every set below
+  size_t words_ = 1;
+  bool nullable_ = false;
+  std::vector<uint64_t> first_;
+  std::vector<uint64_t> last_;
+  // positions_of_[byte * words_] is the set of positions reading byte
+  std::vector<uint64_t> positions_of_;
+  // follow_[(chunk * 256 + bits) * words_] is the union of follow sets of
+  // the positions 8 * chunk + j for every bit j set in bits
+  std::vector<uint64_t> follow_;
+
+  template <size_t Words>
+  bool run(std::string_view text, bool anchored) const;
+
+ public:
+  explicit GlushkovMatcher(const Reg& regular_expression);
+  size_t positions_count() const { return positions_count_; }
+  // whether the whole word belongs to the language
+  bool full_match(std::string_view word) const;
+  // whether some substring of text belongs to the language
+  bool search(std::string_view text) const;
+};
+
+template <RegularExpr Reg>
+GlushkovMatcher<Reg>::GlushkovMatcher(const Reg& regular_expression) {
+  struct Subexpression {
+    bool nullable = false;
+    Positions first{};
+    Positions last{};
+  };
+  auto unite = [](Positions& to, const Positions& from) {
+    for (size_t i = 0; i < kMaxWords; ++i) {
+      to[i] |= from[i];
+    }
+  };
+  std::vector<Positions> follow;
+  std::vector<char> letters;
+  std::stack<Subexpression> stack;
+  for (char symbol : regular_expression) {
+    if (symbol == '.' || symbol == '+') {
+      Subexpression second = stack.top();
+      stack.pop();
+      Subexpression& first = stack.top();
+      if (symbol == '.') {
+        for (size_t i = 0; i < follow.size(); ++i) {
+          if (first.last[i / 64] >> i % 64 & 1) {
+            unite(follow[i], second.first);
+          }
+        }
+        if (first.nullable) {
+          unite(first.first, second.first);
+        }
+        if (second.nullable) {
+          unite(second.last, first.last);
+        }
+        first.last = second.last;
+        first.nullable = first.nullable && second.nullable;
+      } else {
+        unite(first.first, second.first);
+        unite(first.last, second.last);
+        first.nullable = first.nullable || second.nullable;
+      }
+    } else if (symbol == '*') {
+      Subexpression& iterated = stack.top();
+      for (size_t i = 0; i < follow.size(); ++i) {
+        if (iterated.last[i / 64] >> i % 64 & 1) {
+          unite(follow[i], iterated.first);
+        }
+      }
+      iterated.nullable = true;
+    } else if (symbol == '1') {
+      stack.push(Subexpression{true});
+    } else {
+      if (letters.size() == kMaxPositions) {
+        throw std::length_error("GlushkovMatcher: too many positions");
+      }
+      Subexpression letter;
+      size_t position = letters.size();
+      letter.first[position / 64] |= uint64_t(1) << position % 64;
+      letter.last = letter.first;
+      stack.push(letter);
+      letters.push_back(symbol);
+      follow.emplace_back();
+    }
+  }
+  const Subexpression& whole = stack.top();
+
+  positions_count_ = letters.size();
+  words_ = positions_count_ <= 64 ? 1 : kMaxWords;
+  nullable_ = whole.nullable;
+  first_.assign(whole.first.begin(), whole.first.begin() + words_);
+  last_.assign(whole.last.begin(), whole.last.begin() + words_);
+  positions_of_.assign(kAlphabetSize * words_, 0);
+  for (size_t position = 0; position < positions_count_; ++position) {
+    positions_of_[static_cast<unsigned char>(letters[position]) * words_ +
+                  position / 64] |= uint64_t(1) << position % 64;
+  }
+  size_t chunks = (positions_count_ + 7) / 8;
+  follow_.assign(chunks * 256 * words_, 0);
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    for (size_t bits = 1; bits < 256; ++bits) {
+      uint64_t* entry = &follow_[(chunk * 256 + bits) * words_];
+      for (size_t j = 0; j < 8 && 8 * chunk + j < positions_count_; ++j) {
+        if (bits >> j & 1) {
+          for (size_t i = 0; i < words_; ++i) {
+            entry[i] |= follow[8 * chunk + j][i];
+          }
+        }
+      }
+    }
+  }
+}
+
+template <RegularExpr Reg>
+template <size_t Words>
+bool GlushkovMatcher<Reg>::run(std::string_view text, bool anchored) const {
+  using Set = std::array<uint64_t, Words>;
+  size_t chunks = (positions_count_ + 7) / 8;
+  Set first;
+  Set last;
+  std::copy(first_.begin(), first_.end(), first.begin());
+  std::copy(last_.begin(), last_.end(), last.begin());
+  Set states{};
+  bool at_start = true;
+  for (unsigned char byte : text) {
+    const uint64_t* letter = &positions_of_[byte * Words];
+#if defined(__AVX2__)
+    if constexpr (Words == 4) {
+      __m256i next = (anchored && !at_start)
+                         ? _mm256_setzero_si256()
+                         : _mm256_loadu_si256(
+                               reinterpret_cast<const __m256i*>(first.data()));
+      for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        uint8_t bits = static_cast<uint8_t>(states[chunk / 8] >> chunk % 8 * 8);
+        next = _mm256_or_si256(
+            next, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                      &follow_[(chunk * 256 + bits) * 4])));
+      }
+      next = _mm256_and_si256(
+          next, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(letter)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(states.data()), next);
+    } else
+#endif
+    {
+      Set next{};
+      if (!anchored || at_start) {
+        next = first;
+      }
+      for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        uint8_t bits = static_cast<uint8_t>(states[chunk / 8] >> chunk % 8 * 8);
+        const uint64_t* follow = &follow_[(chunk * 256 + bits) * Words];
+        for (size_t i = 0; i < Words; ++i) {
+          next[i] |= follow[i];
+        }
+      }
+      for (size_t i = 0; i < Words; ++i) {
+        states[i] = next[i] & letter[i];
+      }
+    }
+    at_start = false;
+    bool accepted = false;
+    bool alive = false;
+    for (size_t i = 0; i < Words; ++i) {
+      accepted |= (states[i] & last[i]) != 0;
+      alive |= states[i] != 0;
+    }
+    if (!anchored && accepted) {
+      return true;
+    }
+    if (anchored && !alive) {
+      return false;
+    }
+  }
+  if (at_start) {
+    return nullable_;
+  }
+  for (size_t i = 0; i < Words; ++i) {
+    if ((states[i] & last[i]) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <RegularExpr Reg>
+bool GlushkovMatcher<Reg>::full_match(std::string_view word) const {
+  return words_ == 1 ? run<1>(word, true) : run<kMaxWords>(word, true);
+}
+
+// The empty word is a substring of every text
+template <RegularExpr Reg>
+bool GlushkovMatcher<Reg>::search(std::string_view text) const {
+  if (nullable_) {
+    return true;
+  }
+  return words_ == 1 ? run<1>(text, false) : run<kMaxWords>(text, false);
+}
@@ -1,4 +1,8 @@
 #include <cassert>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "NFA.h"
 
@@ -83,6 +87,20 @@ void NFA_constructors_tests() {
   }
 }
 
+void NFA_storage_test() {
+  NFA<> nfa(RegularExpression("ab.c+"), 'a');
+  // two states per letter, a new start and terminal for the union
+  assert(nfa.states_count() == 8);
+  NFA<> iterated = nfa;
+  iterated.Kleene_iteration();
+  assert(ThompsonMatcher(iterated).full_match("abcab"));
+  assert(!ThompsonMatcher(nfa).full_match("abcab"));
+  assert(ThompsonMatcher(nfa).full_match("ab"));
+  NFA<> moved = std::move(iterated);
+  // the iteration adds its own start and terminal
+  assert(moved.states_count() == 10 && DFA(moved).match(""));
+}
+
 void NFA_answer_test() {
   assert(NFA(RegularExpression("a*"), 'a').check_suf(1));
   assert(NFA(RegularExpression("a*"), 'a').check_suf(100));
@@ -91,9 +109,239 @@ void NFA_answer_test() {
   assert(NFA(RegularExpression("acb..bab.c.*.ab.ba.+.+*a."), 'c').check_suf(0));
 }
 
+// Backtracking matcher straight over the postfix form, the reference the
+// automata are checked against
+class ReferenceMatcher {
+ private:
+  struct Term {
+    char symbol;
+    int left = -1;
+    int right = -1;
+  };
+  std::vector<Term> terms_;
+
+  std::set<size_t> ends(int term, const std::string& word, size_t from) const {
+    const Term& current = terms_[term];
+    std::set<size_t> result;
+    if (current.symbol == '1') {
+      result.insert(from);
+    } else if (current.symbol == '.') {
+      for (size_t middle : ends(current.left, word, from)) {
+        std::set<size_t> tail = ends(current.right, word, middle);
+        result.insert(tail.begin(), tail.end());
+      }
+    } else if (current.symbol == '+') {
+      result = ends(current.left, word, from);
+      std::set<size_t> other = ends(current.right, word, from);
+      result.insert(other.begin(), other.end());
+    } else if (current.symbol == '*') {
+      std::vector<size_t> pending = {from};
+      result.insert(from);
+      while (!pending.empty()) {
+        size_t position = pending.back();
+        pending.pop_back();
+        for (size_t end : ends(current.left, word, position)) {
+          if (result.insert(end).second) {
+            pending.push_back(end);
+          }
+        }
+      }
+    } else if (from < word.size() && word[from] == current.symbol) {
+      result.insert(from + 1);
+    }
+    return result;
+  }
+
+ public:
+  explicit ReferenceMatcher(const std::string& expression) {
+    std::vector<int> stack;
+    for (char symbol : expression) {
+      Term term{symbol};
+      if (symbol == '.' || symbol == '+') {
+        term.right = stack.back();
+        stack.pop_back();
+      }
+      if (symbol == '.' || symbol == '+' || symbol == '*') {
+        term.left = stack.back();
+        stack.pop_back();
+      }
+      stack.push_back(static_cast<int>(terms_.size()));
+      terms_.push_back(term);
+    }
+  }
+  bool full_match(const std::string& word) const {
+    return ends(static_cast<int>(terms_.size()) - 1, word, 0)
+        .contains(word.size());
+  }
+  bool search(const std::string& text) const {
+    for (size_t from = 0; from <= text.size(); ++from) {
+      if (!ends(static_cast<int>(terms_.size()) - 1, text, from).empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+const std::vector<std::string> kPatterns = {
+    "a",         "1",         "a*",      "ab.",         "ab+",
+    "a*b+",      "ab*.c+",    "ab.c+*",  "ab+c.aba.*.bac.+.+*",
+    "acb..bab.c.*.ab.ba.+.+*a.", "1*",   "a*b*+*",  "ab*.ab*.+1+c."};
+
+// every word over {a, b, c} up to max_length letters
+std::vector<std::string> all_words(size_t max_length) {
+  std::vector<std::string> words = {""};
+  for (size_t i = 0; i < words.size(); ++i) {
+    if (words[i].size() < max_length) {
+      for (char letter : {'a', 'b', 'c'}) {
+        words.push_back(words[i] + letter);
+      }
+    }
+  }
+  return words;
+}
+
+void DFA_match_test() {
+  std::vector<std::string> words = all_words(6);
+  for (const std::string& pattern : kPatterns) {
+    RegularExpression expression(pattern);
+    ReferenceMatcher reference(pattern);
+    DFA dfa(expression);
+    for (const std::string& word : words) {
+      assert(dfa.match(word) == reference.full_match(word));
+    }
+    assert(!dfa.match("ad") && !dfa.match(std::string(1, '\0')));
+  }
+  // ab.c+* accepts (ab|c)*: start, after a, and dead, minimized
+  assert(DFA(RegularExpression("ab.c+*")).states_count() == 3);
+  assert(DFA(RegularExpression("a*b+")).match("aaa"));
+  assert(!DFA(RegularExpression("a*b+")).match("ba"));
+  assert(!DFA(RegularExpression("b*a.*")).match("ab"));
+  assert(!DFA(RegularExpression("c*a.*c.")).match("cc"));
+}
+
+void Thompson_match_test() {
+  std::vector<std::string> words = all_words(6);
+  for (const std::string& pattern : kPatterns) {
+    ReferenceMatcher reference(pattern);
+    ThompsonMatcher matcher(RegularExpression{pattern});
+    for (const std::string& word : words) {
+      assert(matcher.full_match(word) == reference.full_match(word));
+      assert(matcher.search(word) == reference.search(word));
+    }
+  }
+  // words stopping inside a nested loop are not in the language
+  assert(!ThompsonMatcher(RegularExpression("b*a.*")).full_match("ab"));
+  assert(!ThompsonMatcher(RegularExpression("c*b.*")).full_match("bcc"));
+  assert(!ThompsonMatcher(RegularExpression("1a.*b.*")).full_match("a"));
+  assert(ThompsonMatcher(RegularExpression("b*a.*")).full_match("aba"));
+
+  ThompsonMatcher abc(RegularExpression("ab.c."));
+  assert(abc.search("cc--abc--") && !abc.search("ab-c") && !abc.full_match(""));
+
+  // (a*)^30 b backtracks exponentially on a run of a's, here it is linear
+  std::string hostile = "a*";
+  for (int i = 0; i < 30; ++i) {
+    hostile += "a*.";
+  }
+  ThompsonMatcher slow(RegularExpression(hostile + "b."));
+  std::string text(100'000, 'a');
+  assert(!slow.full_match(text) && !slow.search(text));
+  assert(slow.search(text + "b") && slow.full_match(text + "b"));
+}
+
+void Glushkov_match_test() {
+  std::vector<std::string> words = all_words(6);
+  for (const std::string& pattern : kPatterns) {
+    ReferenceMatcher reference(pattern);
+    GlushkovMatcher matcher(RegularExpression{pattern});
+    for (const std::string& word : words) {
+      assert(matcher.full_match(word) == reference.full_match(word));
+      assert(matcher.search(word) == reference.search(word));
+    }
+  }
+  assert(GlushkovMatcher(RegularExpression("ab+c.aba.*.bac.+.+*"))
+             .positions_count() == 9);
+
+  // 100 positions take the four-word path
+  std::string wide = "ab.c+*";
+  for (int i = 0; i < 33; ++i) {
+    wide += "ab+c.*.";
+  }
+  wide += "a.";
+  ThompsonMatcher thompson(RegularExpression{wide});
+  GlushkovMatcher glushkov(RegularExpression{wide});
+  assert(glushkov.positions_count() == 103);
+  for (const std::string& word : words) {
+    assert(glushkov.full_match(word) == thompson.full_match(word));
+    assert(glushkov.search(word) == thompson.search(word));
+  }
+  assert(glushkov.full_match("abcca") && glushkov.search("xxaxx"));
+
+  std::string too_long = "a";
+  for (size_t i = 0; i < GlushkovMatcher<>::kMaxPositions; ++i) {
+    too_long += "a.";
+  }
+  bool thrown = false;
+  try {
+    GlushkovMatcher matcher{RegularExpression(too_long)};
+  } catch (std::length_error&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+// random well-formed postfix expression with the given number of letters
+std::string random_pattern(std::mt19937& rng, int letters) {
+  std::string pattern;
+  int operands = 0;
+  while (letters > 0 || operands > 1) {
+    unsigned choice = rng() % 8;
+    if (operands > 1 && (letters == 0 || choice < 3)) {
+      pattern += (rng() % 2 == 0) ? '.' : '+';
+      --operands;
+    } else if (operands > 0 && pattern.back() != '*' && choice < 5) {
+      pattern += '*';
+    } else if (letters > 0) {
+      pattern += "abc1"[rng() % 4];
+      ++operands;
+      --letters;
+    }
+  }
+  return pattern;
+}
+
+// DFA, Thompson and Glushkov against the reference on random expressions,
+// hand-picked patterns alone missed words stopping inside nested loops
+void random_match_test() {
+  std::mt19937 rng(2024);
+  std::vector<std::string> words = all_words(5);
+  for (int i = 0; i < 400; ++i) {
+    int letters = 1 + static_cast<int>(rng() % 7);
+    std::string pattern = random_pattern(rng, letters);
+    RegularExpression expression(pattern);
+    ReferenceMatcher reference(pattern);
+    DFA dfa(expression);
+    ThompsonMatcher thompson(expression);
+    GlushkovMatcher glushkov(expression);
+    for (const std::string& word : words) {
+      bool expected = reference.full_match(word);
+      assert(dfa.match(word) == expected);
+      assert(thompson.full_match(word) == expected);
+      assert(glushkov.full_match(word) == expected);
+      assert(thompson.search(word) == glushkov.search(word));
+    }
+  }
+}
+
 int main() {
   regular_expression_tests();
   NFA_constructors_tests();
+  NFA_storage_test();
   NFA_answer_test();
+  DFA_match_test();
+  Thompson_match_test();
+  Glushkov_match_test();
+  random_match_test();
   return 0;
 }
\ No newline at end of file
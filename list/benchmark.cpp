@@ -0,0 +1,340 @@
+// Container/allocator benchmark for List.
+//
+//   g++ -std=c++20 -O2 benchmark.cpp -o benchmark
+//   ./benchmark [--size N] [--repeat R] [--filter substring] > results.json
+//
+// Every workload runs against every allocator in a forked child, so the peak
+// RSS reported is that of the case alone. Allocation counts cover the whole
+// case, setup included. A readable table goes to stderr and a JSON array of
+// results to stdout.
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "list+stackallocator.h"
+
+namespace {
+
+constexpr size_t kArenaSize = size_t(1) << 30;
+
+struct AllocationCounters {
+  size_t allocations = 0;
+  size_t deallocations = 0;
+  size_t bytes = 0;
+};
+
+AllocationCounters counters;
+
+// Forwards to Alloc and counts the calls of the container under test
+template <typename Alloc>
+struct CountingAllocator : Alloc {
+  using value_type = typename Alloc::value_type;
+  using Traits = std::allocator_traits<Alloc>;
+  using propagate_on_container_copy_assignment =
+      typename Traits::propagate_on_container_copy_assignment;
+  using propagate_on_container_move_assignment =
+      typename Traits::propagate_on_container_move_assignment;
+  using propagate_on_container_swap =
+      typename Traits::propagate_on_container_swap;
+  using is_always_equal = typename Traits::is_always_equal;
+  using is_bump_allocator = std::bool_constant<is_bump_allocator_v<Alloc>>;
+
+  CountingAllocator(const Alloc& alloc) : Alloc(alloc) {}
+  template <typename Other>
+  CountingAllocator(const CountingAllocator<Other>& other)
+      : Alloc(static_cast<const Other&>(other)) {}
+  template <typename U>
+  struct rebind {
+    using other =
+        CountingAllocator<typename Traits::template rebind_alloc<U>>;
+  };
+
+  value_type* allocate(size_t count) {
+    ++counters.allocations;
+    counters.bytes += count * sizeof(value_type);
+    return Traits::allocate(*this, count);
+  }
+  void deallocate(value_type* ptr, size_t count) {
+    ++counters.deallocations;
+    Traits::deallocate(*this, ptr, count);
+  }
+  CountingAllocator select_on_container_copy_construction() const {
+    return Traits::select_on_container_copy_construction(*this);
+  }
+};
+
+template <typename First, typename Second>
+bool operator==(const CountingAllocator<First>& first,
+                const CountingAllocator<Second>& second) {
+  return static_cast<const First&>(first) ==
+         static_cast<const Second&>(second);
+}
+
+struct Result {
+  char workload[32] = {};
+  char allocator[32] = {};
+  size_t size = 0;
+  size_t operations = 0;
+  double ns_per_op = 0;
+  long peak_rss_kb = 0;
+  AllocationCounters counters;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Each workload fills what it needs, sets start where timing begins and
+// returns the number of operations it timed
+template <typename Container>
+void Fill(Container& lst, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    lst.push_back(static_cast<int>(i));
+  }
+}
+
+template <typename Container>
+size_t PushPop(Container& lst, size_t size, Clock::time_point& start) {
+  start = Clock::now();
+  for (size_t i = 0; i < size; ++i) {
+    lst.push_back(static_cast<int>(i));
+    lst.push_front(static_cast<int>(i));
+  }
+  for (size_t i = 0; i < size; ++i) {
+    lst.pop_back();
+    lst.pop_front();
+  }
+  return 4 * size;
+}
+
+template <typename Container>
+size_t RandomInsertErase(Container& lst, size_t size,
+                         Clock::time_point& start) {
+  Fill(lst, size);
+  std::mt19937 rng(42);
+  start = Clock::now();
+  // a cursor wanders by small random steps, inserting or erasing where it is
+  auto it = lst.begin();
+  for (size_t i = 0; i < size; ++i) {
+    for (unsigned step = rng() % 8; step > 0 && it != lst.end(); --step) {
+      ++it;
+    }
+    if (it == lst.end()) {
+      it = lst.begin();
+    }
+    if (rng() % 2 == 0) {
+      lst.insert(it, static_cast<int>(i));
+    } else if (lst.size() != 0) {
+      auto next = std::next(it);
+      lst.erase(it);
+      it = (next == lst.end()) ? lst.begin() : next;
+    }
+  }
+  return size;
+}
+
+template <typename Container>
+size_t Iteration(Container& lst, size_t size, Clock::time_point& start) {
+  Fill(lst, size);
+  start = Clock::now();
+  long long sum = 0;
+  for (int j = 0; j < 10; ++j) {
+    for (int x : lst) {
+      sum += x;
+    }
+  }
+  long long n = static_cast<long long>(size);
+  if (sum != n * (n - 1) / 2 * 10) {
+    std::abort();
+  }
+  return 10 * size;
+}
+
+template <typename Container>
+size_t Copy(Container& lst, size_t size, Clock::time_point& start) {
+  Fill(lst, size);
+  start = Clock::now();
+  for (int j = 0; j < 3; ++j) {
+    Container copy = lst;
+    if (copy.size() != size) {
+      std::abort();
+    }
+  }
+  return 3 * size;
+}
+
+template <typename Container>
+size_t Sort(Container& lst, size_t size, Clock::time_point& start) {
+  std::mt19937 rng(42);
+  for (size_t i = 0; i < size; ++i) {
+    lst.push_back(static_cast<int>(rng()));
+  }
+  start = Clock::now();
+  lst.sort();
+  if (!std::is_sorted(lst.begin(), lst.end())) {
+    std::abort();
+  }
+  return size;
+}
+
+template <typename Container, typename Alloc>
+double Run(const std::string& workload, size_t size, Alloc alloc,
+           size_t& operations) {
+  Container lst(alloc);
+  Clock::time_point start;
+  if (workload == "push_pop") {
+    operations = PushPop(lst, size, start);
+  } else if (workload == "random_insert_erase") {
+    operations = RandomInsertErase(lst, size, start);
+  } else if (workload == "iteration") {
+    operations = Iteration(lst, size, start);
+  } else if (workload == "copy") {
+    operations = Copy(lst, size, start);
+  } else {
+    operations = Sort(lst, size, start);
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+template <typename Alloc>
+using Counted = List<int, CountingAllocator<Alloc>>;
+
+double RunWithAllocator(const std::string& workload,
+                        const std::string& allocator, size_t size,
+                        size_t& operations) {
+  if (allocator == "std::allocator") {
+    return Run<Counted<std::allocator<int>>>(workload, size,
+                                             std::allocator<int>(), operations);
+  }
+  if (allocator == "StackAllocator") {
+    auto storage = std::make_unique<StackStorage<kArenaSize>>();
+    return Run<Counted<StackAllocator<int, kArenaSize>>>(
+        workload, size, StackAllocator<int, kArenaSize>(*storage), operations);
+  }
+  if (allocator == "ChunkedStackAllocator") {
+    ChunkedStackStorage storage;
+    return Run<Counted<ChunkedStackAllocator<int>>>(
+        workload, size, ChunkedStackAllocator<int>(storage), operations);
+  }
+  if (allocator == "PoolAllocator") {
+    PoolStorage storage;
+    return Run<Counted<PoolAllocator<int>>>(
+        workload, size, PoolAllocator<int>(storage), operations);
+  }
+  return Run<Counted<ThreadLocalAllocator<int>>>(
+      workload, size, ThreadLocalAllocator<int>(), operations);
+}
+
+// Runs the case in a child process and reads its Result back through a pipe
+bool RunIsolated(const std::string& workload, const std::string& allocator,
+                 size_t size, size_t repeat, Result& result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    Result child;
+    std::strncpy(child.workload, workload.c_str(), sizeof(child.workload) - 1);
+    std::strncpy(child.allocator, allocator.c_str(),
+                 sizeof(child.allocator) - 1);
+    child.size = size;
+    double best = 0;
+    for (size_t i = 0; i < repeat; ++i) {
+      counters = AllocationCounters();
+      double ns = RunWithAllocator(workload, allocator, size, child.operations);
+      if (i == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    child.ns_per_op = best / static_cast<double>(child.operations);
+    child.counters = counters;
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    child.peak_rss_kb = usage.ru_maxrss;
+    bool ok = write(fds[1], &child, sizeof(child)) == sizeof(child);
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+  bool ok = pid > 0 && read(fds[0], &result, sizeof(result)) == sizeof(result);
+  close(fds[0]);
+  int status = 0;
+  if (pid > 0) {
+    waitpid(pid, &status, 0);
+  }
+  return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void PrintJson(std::ostream& out, const std::vector<Result>& results) {
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out << "  {\"workload\": \"" << r.workload << "\", \"allocator\": \""
+        << r.allocator << "\", \"size\": " << r.size
+        << ", \"operations\": " << r.operations
+        << ", \"ns_per_op\": " << r.ns_per_op
+        << ", \"peak_rss_kb\": " << r.peak_rss_kb
+        << ", \"allocations\": " << r.counters.allocations
+        << ", \"deallocations\": " << r.counters.deallocations
+        << ", \"allocated_bytes\": " << r.counters.bytes << "}"
+        << (i + 1 == results.size() ? "\n" : ",\n");
+  }
+  out << "]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t size = 1'000'000;
+  size_t repeat = 3;
+  std::string filter;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag = argv[i];
+    if (flag == "--size") {
+      size = std::stoull(argv[i + 1]);
+    } else if (flag == "--repeat") {
+      repeat = std::max<size_t>(std::stoull(argv[i + 1]), 1);
+    } else if (flag == "--filter") {
+      filter = argv[i + 1];
+    } else {
+      std::cerr << "unknown flag " << flag << std::endl;
+      return 1;
+    }
+  }
+
+  const std::vector<std::string> workloads = {
+      "push_pop", "random_insert_erase", "iteration", "copy", "sort"};
+  const std::vector<std::string> allocators = {
+      "std::allocator", "StackAllocator", "ChunkedStackAllocator",
+      "PoolAllocator", "ThreadLocalAllocator"};
+
+  std::vector<Result> results;
+  for (const std::string& workload : workloads) {
+    for (const std::string& allocator : allocators) {
+      if (!filter.empty() &&
+          (workload + "/" + allocator).find(filter) == std::string::npos) {
+        continue;
+      }
+      Result result;
+      if (!RunIsolated(workload, allocator, size, repeat, result)) {
+        std::cerr << workload << "/" << allocator << " failed" << std::endl;
+        return 1;
+      }
+      std::cerr << workload << "/" << allocator << ": " << result.ns_per_op
+                << " ns/op, peak RSS " << result.peak_rss_kb << " KiB, "
+                << result.counters.allocations << " allocations" << std::endl;
+      results.push_back(result);
+    }
+  }
+  PrintJson(std::cout, results);
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include "list+stackallocator.h"
+
+// Doubly linked list whose nodes all live in one StackStorage and link to
+// each other by 32-bit indices into it (counted in node alignment units)
+// instead of pointers. A node of CompactList<int> is 12 bytes against 24 in
+// List<int>, so twice as many fit into a cache line and into the arena.
+//
+// Erased nodes go to a free list and are reused by later insertions, the
+// arena itself never shrinks. The free list belongs to the list, not to the
+// storage: slots a list still holds when it is destroyed are lost to the
+// other lists sharing the storage, so creating and destroying lists in a
+// loop keeps growing the arena. Reuse one list through clear() there, or
+// rewind the storage with an ArenaScope around each round. Iterators stay
+// valid until their element is erased.
+template <typename T, size_t N>
+class CompactList {
+ private:
+  using Index = uint32_t;
+  static constexpr Index kNull = std::numeric_limits<Index>::max();
+
+  struct Node {
+    Index prev;
+    Index next;
+    T object;
+  };
+
+  static constexpr size_t kUnit = alignof(Node);
+  static_assert(N / kUnit < kNull, "StackStorage is too large for 32-bit links");
+
+  StackStorage<N>* storage_;
+  Index head_ = kNull;
+  Index tail_ = kNull;
+  Index free_ = kNull;
+  size_t size_ = 0;
+
+  Node& node(Index index) const {
+    return *reinterpret_cast<Node*>(storage_->stack_storage + index * kUnit);
+  }
+  Index index_of(const Node* node) const {
+    return static_cast<Index>(
+        (reinterpret_cast<const char*>(node) - storage_->stack_storage) /
+        kUnit);
+  }
+  Index allocate_node();
+  void link_before(Index pos, Index index);
+  void swap(CompactList& other);
+
+ public:
+  template <bool IsConst>
+  class iterator_common {
+   public:
+    using value_type = T;
+    using difference_type = int;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using list_pointer =
+        std::conditional_t<IsConst, const CompactList*, CompactList*>;
+
+    list_pointer list_iter = nullptr;
+    Index index = kNull;
+
+    iterator_common() = default;
+    iterator_common(list_pointer list, Index index)
+        : list_iter(list), index(index) {}
+    operator iterator_common<true>() const {
+      return iterator_common<true>(list_iter, index);
+    }
+
+    reference operator*() const { return list_iter->node(index).object; }
+    pointer operator->() const { return &list_iter->node(index).object; }
+    iterator_common& operator++() {
+      index = list_iter->node(index).next;
+      return *this;
+    }
+    iterator_common operator++(int) {
+      iterator_common copy = *this;
+      ++*this;
+      return copy;
+    }
+    iterator_common& operator--() {
+      index = (index == kNull) ? list_iter->tail_ : list_iter->node(index).prev;
+      return *this;
+    }
+    iterator_common operator--(int) {
+      iterator_common copy = *this;
+      --*this;
+      return copy;
+    }
+    bool operator==(const iterator_common& other) const {
+      return index == other.index;
+    }
+    bool operator!=(const iterator_common& other) const {
+      return !(*this == other);
+    }
+  };
+
+  using iterator = iterator_common<false>;
+  using const_iterator = iterator_common<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  explicit CompactList(StackStorage<N>& storage) : storage_(&storage) {}
+  CompactList(size_t size, const T& element, StackStorage<N>& storage);
+  ~CompactList();
+  CompactList(const CompactList& other);
+  CompactList(CompactList&& other) noexcept;
+  CompactList& operator=(const CompactList& other);
+  CompactList& operator=(CompactList&& other) noexcept;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  void clear();
+  T& front() { return node(head_).object; }
+  T& back() { return node(tail_).object; }
+  void push_back(const T& new_t) { emplace(cend(), new_t); }
+  void push_front(const T& new_t) { emplace(cbegin(), new_t); }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(cend(), std::forward<Args>(args)...);
+  }
+  void pop_back() { erase(const_iterator(this, tail_)); }
+  void pop_front() { erase(const_iterator(this, head_)); }
+  template <typename... Args>
+  iterator emplace(const_iterator it, Args&&... args);
+  iterator insert(const_iterator it, const T& element) {
+    return emplace(it, element);
+  }
+  iterator erase(const_iterator it);
+
+  iterator begin() { return iterator(this, head_); }
+  iterator end() { return iterator(this, kNull); }
+  const_iterator begin() const { return const_iterator(this, head_); }
+  const_iterator end() const { return const_iterator(this, kNull); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+};
+
+template <typename T, size_t N>
+typename CompactList<T, N>::Index CompactList<T, N>::allocate_node() {
+  if (free_ != kNull) {
+    Index index = free_;
+    free_ = node(index).next;
+    return index;
+  }
+  return index_of(static_cast<Node*>(
+      storage_->allocate_bytes(sizeof(Node), alignof(Node))));
+}
+
+template <typename T, size_t N>
+void CompactList<T, N>::link_before(Index pos, Index index) {
+  Node& new_node = node(index);
+  new_node.next = pos;
+  new_node.prev = (pos == kNull) ? tail_ : node(pos).prev;
+  (new_node.prev == kNull ? head_ : node(new_node.prev).next) = index;
+  (pos == kNull ? tail_ : node(pos).prev) = index;
+  ++size_;
+}
+
+template <typename T, size_t N>
+void CompactList<T, N>::swap(CompactList& other) {
+  std::swap(storage_, other.storage_);
+  std::swap(head_, other.head_);
+  std::swap(tail_, other.tail_);
+  std::swap(free_, other.free_);
+  std::swap(size_, other.size_);
+}
+
+template <typename T, size_t N>
+CompactList<T, N>::CompactList(size_t size, const T& element,
+                               StackStorage<N>& storage)
+    : storage_(&storage) {
+  try {
+    for (size_t i = 0; i < size; ++i) {
+      push_back(element);
+    }
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+template <typename T, size_t N>
+CompactList<T, N>::~CompactList() {
+  clear();
+}
+
+template <typename T, size_t N>
+CompactList<T, N>::CompactList(const CompactList& other)
+    : storage_(other.storage_) {
+  try {
+    for (const T& element : other) {
+      push_back(element);
+    }
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+template <typename T, size_t N>
+CompactList<T, N>::CompactList(CompactList&& other) noexcept
+    : storage_(other.storage_) {
+  swap(other);
+}
+
+template <typename T, size_t N>
+CompactList<T, N>& CompactList<T, N>::operator=(const CompactList& other) {
+  CompactList new_list(other);
+  swap(new_list);
+  return *this;
+}
+
+template <typename T, size_t N>
+CompactList<T, N>& CompactList<T, N>::operator=(CompactList&& other) noexcept {
+  CompactList new_list(std::move(other));
+  swap(new_list);
+  return *this;
+}
+
+template <typename T, size_t N>
+void CompactList<T, N>::clear() {
+  while (size_ > 0) {
+    pop_back();
+  }
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+typename CompactList<T, N>::iterator CompactList<T, N>::emplace(
+    const_iterator it, Args&&... args) {
+  Index index = allocate_node();
+  try {
+    new (&node(index).object) T(std::forward<Args>(args)...);
+  } catch (...) {
+    node(index).next = free_;
+    free_ = index;
+    throw;
+  }
+  link_before(it.index, index);
+  return iterator(this, index);
+}
+
+template <typename T, size_t N>
+typename CompactList<T, N>::iterator CompactList<T, N>::erase(
+    const_iterator it) {
+  Node& erased = node(it.index);
+  Index next = erased.next;
+  (erased.prev == kNull ? head_ : node(erased.prev).next) = next;
+  (next == kNull ? tail_ : node(next).prev) = erased.prev;
+  erased.object.~T();
+  erased.next = free_;
+  free_ = it.index;
+  --size_;
+  return iterator(this, next);
+}
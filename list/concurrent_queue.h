@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "list+stackallocator.h"
+
+// Lock-free multi-producer multi-consumer FIFO queue (Michael & Scott).
+// Nodes go through allocator_traits like List's, so the allocator has to be
+// safe to call from several threads: std::allocator or ChunkedStackAllocator.
+//
+// Popped nodes are reclaimed with hazard pointers: every running operation
+// holds one of kMaxThreads records publishing the nodes it dereferences, and
+// a retired node is freed only when no record points at it.
+template <typename T, typename Alloc = std::allocator<T>>
+class ConcurrentQueue {
+ public:
+  static constexpr size_t kMaxThreads = 128;
+
+ private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* value() { return reinterpret_cast<T*>(storage); }
+  };
+
+  struct alignas(kCacheLineSize) Record {
+    std::atomic<bool> active{false};
+    std::array<std::atomic<Node*>, 2> hazards{};
+    // owned by whoever holds the record, no synchronization needed
+    std::vector<Node*> retired;
+  };
+
+  // retired nodes are scanned in batches proportional to the hazard count,
+  // so reclamation costs O(1) amortized per pop
+  static constexpr size_t kScanThreshold = 2 * 2 * kMaxThreads;
+
+  using NodeAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  alignas(kCacheLineSize) std::atomic<Node*> head_;
+  alignas(kCacheLineSize) std::atomic<Node*> tail_;
+  [[no_unique_address]] NodeAlloc allocator_;
+  mutable std::array<Record, kMaxThreads> records_;
+
+  Node* create_dummy();
+  template <typename... Args>
+  Node* create_node(Args&&... args);
+  void deallocate_node(Node* node);
+  Record* acquire_record() const;
+  static void release_record(Record* record);
+  static Node* protect(std::atomic<Node*>& hazard,
+                       const std::atomic<Node*>& source);
+  void retire(Record* record, Node* node);
+  void scan(Record* record);
+  void link(Node* node);
+
+ public:
+  ConcurrentQueue(Alloc allocator = Alloc());
+  ~ConcurrentQueue();
+  ConcurrentQueue(const ConcurrentQueue&) = delete;
+  ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+
+  void push(const T& element);
+  void push(T&& element);
+  template <typename... Args>
+  void emplace(Args&&... args);
+  // moves the oldest element into out, false if the queue was empty
+  bool try_pop(T& out);
+  // a snapshot only, other threads may change it right away
+  bool empty() const;
+};
+
+template <typename T, typename Alloc>
+typename ConcurrentQueue<T, Alloc>::Node*
+ConcurrentQueue<T, Alloc>::create_dummy() {
+  Node* node = NodeTraits::allocate(allocator_, 1);
+  return new (node) Node();
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+typename ConcurrentQueue<T, Alloc>::Node*
+ConcurrentQueue<T, Alloc>::create_node(Args&&... args) {
+  Node* node = create_dummy();
+  try {
+    NodeTraits::construct(allocator_, node->value(),
+                          std::forward<Args>(args)...);
+  } catch (...) {
+    deallocate_node(node);
+    throw;
+  }
+  return node;
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::deallocate_node(Node* node) {
+  node->~Node();
+  NodeTraits::deallocate(allocator_, node, 1);
+}
+
+template <typename T, typename Alloc>
+typename ConcurrentQueue<T, Alloc>::Record*
+ConcurrentQueue<T, Alloc>::acquire_record() const {
+  // each thread retries the record it got last time, so in steady state it
+  // owns a private cache line and the acquire is one uncontended exchange
+  thread_local size_t hint =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) % kMaxThreads;
+  for (size_t i = 0; i < kMaxThreads; ++i) {
+    size_t index = (hint + i) % kMaxThreads;
+    Record& record = records_[index];
+    if (!record.active.load(std::memory_order_relaxed) &&
+        !record.active.exchange(true, std::memory_order_acquire)) {
+      hint = index;
+      return &record;
+    }
+  }
+  throw std::runtime_error("ConcurrentQueue: too many threads");
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::release_record(Record* record) {
+  record->hazards[0].store(nullptr, std::memory_order_release);
+  record->hazards[1].store(nullptr, std::memory_order_release);
+  record->active.store(false, std::memory_order_release);
+}
+
+// Publishes source in the hazard slot and rereads it, once both agree the
+// node cannot be freed until the slot is cleared
+template <typename T, typename Alloc>
+typename ConcurrentQueue<T, Alloc>::Node* ConcurrentQueue<T, Alloc>::protect(
+    std::atomic<Node*>& hazard, const std::atomic<Node*>& source) {
+  Node* ptr = source.load(std::memory_order_relaxed);
+  while (true) {
+    hazard.store(ptr);
+    Node* again = source.load();
+    if (again == ptr) {
+      return ptr;
+    }
+    ptr = again;
+  }
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::retire(Record* record, Node* node) {
+  record->retired.push_back(node);
+  if (record->retired.size() >= kScanThreshold) {
+    scan(record);
+  }
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::scan(Record* record) {
+  std::vector<Node*> hazards;
+  hazards.reserve(2 * kMaxThreads);
+  for (Record& other : records_) {
+    for (std::atomic<Node*>& hazard : other.hazards) {
+      if (Node* ptr = hazard.load()) {
+        hazards.push_back(ptr);
+      }
+    }
+  }
+  std::sort(hazards.begin(), hazards.end());
+  auto still_used = std::partition(
+      record->retired.begin(), record->retired.end(), [&hazards](Node* node) {
+        return std::binary_search(hazards.begin(), hazards.end(), node);
+      });
+  for (auto it = still_used; it != record->retired.end(); ++it) {
+    deallocate_node(*it);
+  }
+  record->retired.erase(still_used, record->retired.end());
+}
+
+template <typename T, typename Alloc>
+ConcurrentQueue<T, Alloc>::ConcurrentQueue(Alloc allocator)
+    : allocator_(allocator) {
+  Node* dummy = create_dummy();
+  head_.store(dummy, std::memory_order_relaxed);
+  tail_.store(dummy, std::memory_order_relaxed);
+}
+
+// Not thread-safe: every other thread has to be done with the queue
+template <typename T, typename Alloc>
+ConcurrentQueue<T, Alloc>::~ConcurrentQueue() {
+  Node* node = head_.load(std::memory_order_relaxed);
+  Node* next = node->next.load(std::memory_order_relaxed);
+  deallocate_node(node);
+  while (next != nullptr) {
+    node = next;
+    next = node->next.load(std::memory_order_relaxed);
+    NodeTraits::destroy(allocator_, node->value());
+    deallocate_node(node);
+  }
+  for (Record& record : records_) {
+    for (Node* retired : record.retired) {
+      deallocate_node(retired);
+    }
+  }
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::link(Node* node) {
+  Record* record = acquire_record();
+  while (true) {
+    Node* tail = protect(record->hazards[0], tail_);
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail != tail_.load(std::memory_order_acquire)) {
+      continue;
+    }
+    if (next != nullptr) {
+      // help a producer that linked its node but has not moved the tail yet
+      tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                  std::memory_order_relaxed);
+      continue;
+    }
+    if (tail->next.compare_exchange_weak(next, node, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+      tail_.compare_exchange_strong(tail, node, std::memory_order_release,
+                                    std::memory_order_relaxed);
+      break;
+    }
+  }
+  release_record(record);
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::push(const T& element) {
+  link(create_node(element));
+}
+
+template <typename T, typename Alloc>
+void ConcurrentQueue<T, Alloc>::push(T&& element) {
+  link(create_node(std::move(element)));
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+void ConcurrentQueue<T, Alloc>::emplace(Args&&... args) {
+  link(create_node(std::forward<Args>(args)...));
+}
+
+// The head is always a dummy node, the first element lives in head->next.
+// The consumer that swings head to next owns that element and next becomes
+// the new dummy, the old head is retired.
+template <typename T, typename Alloc>
+bool ConcurrentQueue<T, Alloc>::try_pop(T& out) {
+  Record* record = acquire_record();
+  while (true) {
+    Node* head = protect(record->hazards[0], head_);
+    Node* tail = tail_.load(std::memory_order_acquire);
+    Node* next = head->next.load(std::memory_order_acquire);
+    record->hazards[1].store(next);
+    if (head != head_.load()) {
+      continue;
+    }
+    if (next == nullptr) {
+      release_record(record);
+      return false;
+    }
+    if (head == tail) {
+      tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                  std::memory_order_relaxed);
+      continue;
+    }
+    if (head_.compare_exchange_weak(head, next, std::memory_order_acq_rel,
+                                    std::memory_order_relaxed)) {
+      out = std::move(*next->value());
+      NodeTraits::destroy(allocator_, next->value());
+      record->hazards[0].store(nullptr, std::memory_order_release);
+      record->hazards[1].store(nullptr, std::memory_order_release);
+      retire(record, head);
+      release_record(record);
+      return true;
+    }
+  }
+}
+
+template <typename T, typename Alloc>
+bool ConcurrentQueue<T, Alloc>::empty() const {
+  Record* record = acquire_record();
+  Node* head = protect(record->hazards[0], head_);
+  bool result = head->next.load(std::memory_order_acquire) == nullptr;
+  release_record(record);
+  return result;
+}
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <compare>
+#include <concepts>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "list+stackallocator.h"
+
+// Double-ended queue over one contiguous ring buffer whose capacity is a
+// power of two, so a logical index maps to a slot with a mask. Pushes and
+// pops at both ends are amortized O(1) and never touch the allocator until
+// the ring is full; FIFO traffic cycles through the same cache lines.
+//
+// When the allocator can grow a block in place (StackAllocator::extend, for
+// the block on top of the arena) the ring is doubled without moving to a new
+// buffer, so a growing deque does not leave its old buffers behind in the
+// arena.
+//
+// Iterators are invalidated by any insertion and by erasing the element they
+// point to.
+template <typename T, typename Alloc = std::allocator<T>>
+class Deque {
+ private:
+  using AllocTraits =
+      typename std::allocator_traits<Alloc>::template rebind_traits<T>;
+  using TAlloc = typename AllocTraits::allocator_type;
+
+  T* buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  [[no_unique_address]] TAlloc allocator_;
+
+  T* slot(size_t index) const {
+    return buffer_ + ((head_ + index) & (capacity_ - 1));
+  }
+  void grow();
+  bool grow_in_place(size_t new_capacity);
+  void reallocate(size_t new_capacity);
+  // destroys the elements and frees the buffer
+  void release();
+  void swap(Deque& other);
+  // args may refer into the ring that grow() moves and frees, so the new
+  // element is built before it
+  template <typename... Args>
+  T& grow_and_emplace(bool front, Args&&... args) {
+    T value(std::forward<Args>(args)...);
+    grow();
+    return front ? emplace_front(std::move_if_noexcept(value))
+                 : emplace_back(std::move_if_noexcept(value));
+  }
+
+ public:
+  template <bool IsConst>
+  class iterator_common {
+   public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using iterator_category = std::random_access_iterator_tag;
+    using deque_pointer = std::conditional_t<IsConst, const Deque*, Deque*>;
+
+    deque_pointer deque_iter = nullptr;
+    size_t index = 0;
+
+    iterator_common() = default;
+    iterator_common(deque_pointer deque, size_t index)
+        : deque_iter(deque), index(index) {}
+    operator iterator_common<true>() const {
+      return iterator_common<true>(deque_iter, index);
+    }
+
+    reference operator*() const { return *deque_iter->slot(index); }
+    pointer operator->() const { return deque_iter->slot(index); }
+    reference operator[](difference_type shift) const {
+      return *deque_iter->slot(index + shift);
+    }
+    iterator_common& operator++() {
+      ++index;
+      return *this;
+    }
+    iterator_common operator++(int) {
+      iterator_common copy = *this;
+      ++index;
+      return copy;
+    }
+    iterator_common& operator--() {
+      --index;
+      return *this;
+    }
+    iterator_common operator--(int) {
+      iterator_common copy = *this;
+      --index;
+      return copy;
+    }
+    iterator_common& operator+=(difference_type shift) {
+      index += shift;
+      return *this;
+    }
+    iterator_common& operator-=(difference_type shift) {
+      index -= shift;
+      return *this;
+    }
+    iterator_common operator+(difference_type shift) const {
+      return iterator_common(deque_iter, index + shift);
+    }
+    friend iterator_common operator+(difference_type shift,
+                                     const iterator_common& it) {
+      return it + shift;
+    }
+    iterator_common operator-(difference_type shift) const {
+      return iterator_common(deque_iter, index - shift);
+    }
+    difference_type operator-(const iterator_common& other) const {
+      return static_cast<difference_type>(index) -
+             static_cast<difference_type>(other.index);
+    }
+    bool operator==(const iterator_common& other) const {
+      return index == other.index;
+    }
+    std::strong_ordering operator<=>(const iterator_common& other) const {
+      return index <=> other.index;
+    }
+  };
+
+  using iterator = iterator_common<false>;
+  using const_iterator = iterator_common<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  Deque() = default;
+  Deque(Alloc allocator) : allocator_(allocator) {}
+  Deque(size_t size, const T& element, Alloc allocator = Alloc());
+  ~Deque();
+  Deque(const Deque& other);
+  Deque(Deque&& other) noexcept;
+  Deque& operator=(const Deque& other);
+  Deque& operator=(Deque&& other) noexcept(
+      AllocTraits::propagate_on_container_move_assignment::value ||
+      AllocTraits::is_always_equal::value);
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+  void reserve(size_t capacity);
+  void clear();
+
+  T& operator[](size_t index) { return *slot(index); }
+  const T& operator[](size_t index) const { return *slot(index); }
+  T& at(size_t index);
+  const T& at(size_t index) const;
+  T& front() { return *slot(0); }
+  const T& front() const { return *slot(0); }
+  T& back() { return *slot(size_ - 1); }
+  const T& back() const { return *slot(size_ - 1); }
+
+  void push_back(const T& new_t) { emplace_back(new_t); }
+  void push_back(T&& new_t) { emplace_back(std::move(new_t)); }
+  void push_front(const T& new_t) { emplace_front(new_t); }
+  void push_front(T&& new_t) { emplace_front(std::move(new_t)); }
+  // defined in the class so that the fast path gets inlined into loops
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) [[unlikely]] {
+      return grow_and_emplace(false, std::forward<Args>(args)...);
+    }
+    T* place = slot(size_);
+    AllocTraits::construct(allocator_, place, std::forward<Args>(args)...);
+    ++size_;
+    return *place;
+  }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    if (size_ == capacity_) [[unlikely]] {
+      return grow_and_emplace(true, std::forward<Args>(args)...);
+    }
+    size_t new_head = (head_ + capacity_ - 1) & (capacity_ - 1);
+    AllocTraits::construct(allocator_, buffer_ + new_head,
+                           std::forward<Args>(args)...);
+    head_ = new_head;
+    ++size_;
+    return buffer_[head_];
+  }
+  void pop_back() {
+    AllocTraits::destroy(allocator_, slot(size_ - 1));
+    --size_;
+  }
+  void pop_front() {
+    AllocTraits::destroy(allocator_, slot(0));
+    head_ = (head_ + 1) & (capacity_ - 1);
+    --size_;
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+};
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::grow() {
+  size_t new_capacity = (capacity_ == 0) ? 8 : 2 * capacity_;
+  if (!grow_in_place(new_capacity)) {
+    reallocate(new_capacity);
+  }
+}
+
+// The ring keeps its head; the part that wrapped around to the front of the
+// buffer moves right after the old end, into the extension
+template <typename T, typename Alloc>
+bool Deque<T, Alloc>::grow_in_place([[maybe_unused]] size_t new_capacity) {
+  if constexpr (requires(TAlloc& alloc, T* ptr, size_t n) {
+                  { alloc.extend(ptr, n, n) } -> std::convertible_to<bool>;
+                }) {
+    if (buffer_ == nullptr ||
+        !allocator_.extend(buffer_, capacity_, new_capacity)) {
+      return false;
+    }
+    size_t wrapped =
+        (head_ + size_ > capacity_) ? head_ + size_ - capacity_ : 0;
+    size_t moved = 0;
+    try {
+      for (; moved < wrapped; ++moved) {
+        AllocTraits::construct(allocator_, buffer_ + capacity_ + moved,
+                               std::move_if_noexcept(buffer_[moved]));
+      }
+    } catch (...) {
+      for (size_t i = 0; i < moved; ++i) {
+        AllocTraits::destroy(allocator_, buffer_ + capacity_ + i);
+      }
+      throw;
+    }
+    for (size_t i = 0; i < wrapped; ++i) {
+      AllocTraits::destroy(allocator_, buffer_ + i);
+    }
+    capacity_ = new_capacity;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::reallocate(size_t new_capacity) {
+  T* new_buffer = AllocTraits::allocate(allocator_, new_capacity);
+  size_t moved = 0;
+  try {
+    for (; moved < size_; ++moved) {
+      AllocTraits::construct(allocator_, new_buffer + moved,
+                             std::move_if_noexcept(*slot(moved)));
+    }
+  } catch (...) {
+    for (size_t i = 0; i < moved; ++i) {
+      AllocTraits::destroy(allocator_, new_buffer + i);
+    }
+    AllocTraits::deallocate(allocator_, new_buffer, new_capacity);
+    throw;
+  }
+  for (size_t i = 0; i < size_; ++i) {
+    AllocTraits::destroy(allocator_, slot(i));
+  }
+  if (buffer_ != nullptr) {
+    AllocTraits::deallocate(allocator_, buffer_, capacity_);
+  }
+  buffer_ = new_buffer;
+  capacity_ = new_capacity;
+  head_ = 0;
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::swap(Deque& other) {
+  std::swap(buffer_, other.buffer_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(head_, other.head_);
+  std::swap(size_, other.size_);
+}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(size_t size, const T& element, Alloc allocator)
+    : allocator_(allocator) {
+  reserve(size);
+  try {
+    for (size_t i = 0; i < size; ++i) {
+      emplace_back(element);
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::~Deque() {
+  release();
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::release() {
+  clear();
+  if (buffer_ != nullptr) {
+    AllocTraits::deallocate(allocator_, buffer_, capacity_);
+    buffer_ = nullptr;
+    capacity_ = 0;
+  }
+}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(const Deque& other)
+    : allocator_(
+          AllocTraits::select_on_container_copy_construction(other.allocator_)) {
+  reserve(other.size_);
+  try {
+    for (const T& element : other) {
+      emplace_back(element);
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>::Deque(Deque&& other) noexcept
+    : allocator_(std::move(other.allocator_)) {
+  swap(other);
+}
+
+template <typename T, typename Alloc>
+Deque<T, Alloc>& Deque<T, Alloc>::operator=(const Deque& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // the copy is built by the allocator this deque ends up with and the old
+  // buffer leaves together with the allocator that made it
+  constexpr bool kPropagate =
+      AllocTraits::propagate_on_container_copy_assignment::value;
+  Deque new_deque(allocator_);
+  if constexpr (kPropagate) {
+    new_deque.allocator_ = other.allocator_;
+  }
+  new_deque.reserve(other.size_);
+  for (const T& element : other) {
+    new_deque.emplace_back(element);
+  }
+  if constexpr (kPropagate) {
+    std::swap(allocator_, new_deque.allocator_);
+  }
+  swap(new_deque);
+  return *this;
+}
+
+// The buffer is only taken over when it can be freed by our allocator,
+// otherwise the elements are moved one by one, which may throw
+template <typename T, typename Alloc>
+Deque<T, Alloc>& Deque<T, Alloc>::operator=(Deque&& other) noexcept(
+    AllocTraits::propagate_on_container_move_assignment::value ||
+    AllocTraits::is_always_equal::value) {
+  if (this == &other) {
+    return *this;
+  }
+  if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+    Deque new_deque(std::move(other));
+    std::swap(allocator_, new_deque.allocator_);
+    swap(new_deque);
+  } else if (allocator_ == other.allocator_) {
+    Deque new_deque(std::move(other));
+    swap(new_deque);
+  } else {
+    clear();
+    for (T& element : other) {
+      emplace_back(std::move(element));
+    }
+    other.clear();
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::reserve(size_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  size_t new_capacity = (capacity_ == 0) ? 8 : capacity_;
+  while (new_capacity < capacity) {
+    new_capacity *= 2;
+  }
+  if (!grow_in_place(new_capacity)) {
+    reallocate(new_capacity);
+  }
+}
+
+template <typename T, typename Alloc>
+void Deque<T, Alloc>::clear() {
+  while (size_ > 0) {
+    pop_back();
+  }
+  head_ = 0;
+}
+
+template <typename T, typename Alloc>
+T& Deque<T, Alloc>::at(size_t index) {
+  if (index >= size_) {
+    throw std::out_of_range("Deque::at");
+  }
+  return *slot(index);
+}
+
+template <typename T, typename Alloc>
+const T& Deque<T, Alloc>::at(size_t index) const {
+  if (index >= size_) {
+    throw std::out_of_range("Deque::at");
+  }
+  return *slot(index);
+}
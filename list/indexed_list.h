@@ -0,0 +1,464 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "list+stackallocator.h"
+
+// Sequence with O(log n) expected positional access: an indexable skip list
+// whose bottom level is List's circular hook chain. Every node also carries
+// a tower of express links, each storing how many positions it skips, so
+// at(i), insert_at(i) and erase_at(i) descend the towers instead of walking
+// from the front, and index_of(it) climbs them towards the end.
+//
+// Towers are geometric with p = 1/4, about 1.33 links per node on average,
+// and live in the same allocation as the node. Iterators are List's hook
+// iterators and stay valid until their element is erased.
+template <typename T, typename Alloc = std::allocator<T>>
+class IndexedList {
+ private:
+  static constexpr unsigned kMaxHeight = 16;
+
+  // express link of levels 1 and up, level 0 is the hook itself with width 1
+  struct Level {
+    ListHook* next;
+    // positions skipped; a null next points past the end at size() + 1
+    size_t width;
+  };
+
+  struct Node : ListHook {
+    T object;
+    unsigned height;
+  };
+
+  using NodeAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  struct NodeAccess {
+    using value_type = T;
+    static T& value(ListHook* hook) {
+      return static_cast<Node*>(hook)->object;
+    }
+  };
+
+  ListHook sentinel_{&sentinel_, &sentinel_};
+  std::array<Level, kMaxHeight - 1> head_levels_{};
+  // tallest tower in use, levels of head_levels_ above it are stale
+  unsigned height_ = 1;
+  size_t size_ = 0;
+  std::minstd_rand random_;
+  [[no_unique_address]] NodeAlloc allocator_;
+
+  // the tower is placed right after the node, in whole Node units
+  static size_t node_units(unsigned height) {
+    return 1 + ((height - 1) * sizeof(Level) + sizeof(Node) - 1) /
+                   sizeof(Node);
+  }
+  // link of hook on level, 1 <= level < height_of(hook)
+  Level& link(ListHook* hook, unsigned level) {
+    if (hook == &sentinel_) {
+      return head_levels_[level - 1];
+    }
+    return reinterpret_cast<Level*>(static_cast<Node*>(hook) + 1)[level - 1];
+  }
+  unsigned height_of(const ListHook* hook) const {
+    return hook == &sentinel_ ? kMaxHeight
+                              : static_cast<const Node*>(hook)->height;
+  }
+  ListHook* end_hook() const { return const_cast<ListHook*>(&sentinel_); }
+  unsigned random_height();
+  // the hook at 1-based rank, the sentinel being rank 0
+  ListHook* hook_at(size_t rank) const;
+  // fills path[level] with the last hook before rank on every level and
+  // ranks[level] with its rank, returns the hook before rank on level 0
+  ListHook* find_path(size_t rank, std::array<ListHook*, kMaxHeight>& path,
+                      std::array<size_t, kMaxHeight>& ranks);
+  template <typename... Args>
+  Node* create_node(Args&&... args);
+  void destroy_node(ListHook* hook);
+  void relink_sentinel();
+  void swap(IndexedList& other);
+
+ public:
+  template <bool IsConst>
+  using iterator_common = HookIterator<NodeAccess, IsConst>;
+
+  using iterator = iterator_common<false>;
+  using const_iterator = iterator_common<true>;
+  using reverse_iterator = HookReverseIterator<iterator>;
+  using const_reverse_iterator = HookReverseIterator<const_iterator>;
+
+  IndexedList() = default;
+  IndexedList(Alloc allocator) : allocator_(allocator) {}
+  IndexedList(std::initializer_list<T> elements, Alloc allocator = Alloc());
+  ~IndexedList();
+  IndexedList(const IndexedList& other);
+  IndexedList(IndexedList&& other) noexcept;
+  IndexedList& operator=(const IndexedList& other);
+  IndexedList& operator=(IndexedList&& other) noexcept(
+      NodeTraits::propagate_on_container_move_assignment::value ||
+      NodeTraits::is_always_equal::value);
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  void clear();
+
+  T& operator[](size_t index) { return NodeAccess::value(hook_at(index + 1)); }
+  const T& operator[](size_t index) const {
+    return NodeAccess::value(hook_at(index + 1));
+  }
+  T& at(size_t index);
+  const T& at(size_t index) const;
+  iterator nth(size_t index) { return iterator(hook_at(index + 1)); }
+  const_iterator nth(size_t index) const {
+    return const_iterator(hook_at(index + 1));
+  }
+  // position of the element, size() for end()
+  size_t index_of(const_iterator it) const;
+
+  template <typename... Args>
+  iterator emplace_at(size_t index, Args&&... args);
+  iterator insert_at(size_t index, const T& element) {
+    return emplace_at(index, element);
+  }
+  iterator insert_at(size_t index, T&& element) {
+    return emplace_at(index, std::move(element));
+  }
+  void erase_at(size_t index);
+  iterator insert(const_iterator it, const T& element) {
+    return emplace_at(index_of(it), element);
+  }
+  iterator insert(const_iterator it, T&& element) {
+    return emplace_at(index_of(it), std::move(element));
+  }
+  iterator erase(const_iterator it);
+
+  void push_back(const T& new_t) { emplace_at(size_, new_t); }
+  void push_back(T&& new_t) { emplace_at(size_, std::move(new_t)); }
+  void push_front(const T& new_t) { emplace_at(0, new_t); }
+  void push_front(T&& new_t) { emplace_at(0, std::move(new_t)); }
+  void pop_back() { erase_at(size_ - 1); }
+  void pop_front() { erase_at(0); }
+
+  iterator begin() { return iterator(sentinel_.next); }
+  iterator end() { return iterator(end_hook()); }
+  const_iterator begin() const { return const_iterator(sentinel_.next); }
+  const_iterator end() const { return const_iterator(end_hook()); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  // reverse iterators point at their element itself, as in List
+  reverse_iterator rbegin() { return iterator(sentinel_.prev); }
+  reverse_iterator rend() { return iterator(end_hook()); }
+  const_reverse_iterator rbegin() const {
+    return const_iterator(sentinel_.prev);
+  }
+  const_reverse_iterator rend() const { return const_iterator(end_hook()); }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+};
+
+template <typename T, typename Alloc>
+unsigned IndexedList<T, Alloc>::random_height() {
+  // minstd_rand yields 31 random bits, two of them per level
+  unsigned bits = static_cast<unsigned>(random_()) | (1u << 30);
+  return std::min(1 + std::countr_zero(bits) / 2, int(kMaxHeight));
+}
+
+template <typename T, typename Alloc>
+ListHook* IndexedList<T, Alloc>::hook_at(size_t rank) const {
+  auto* self = const_cast<IndexedList*>(this);
+  ListHook* hook = end_hook();
+  size_t position = 0;
+  for (unsigned level = height_ - 1; level > 0; --level) {
+    for (Level* step = &self->link(hook, level);
+         step->next != nullptr && position + step->width <= rank;
+         step = &self->link(hook, level)) {
+      position += step->width;
+      hook = step->next;
+    }
+  }
+  for (; position < rank; ++position) {
+    hook = hook->next;
+  }
+  return hook;
+}
+
+template <typename T, typename Alloc>
+ListHook* IndexedList<T, Alloc>::find_path(
+    size_t rank, std::array<ListHook*, kMaxHeight>& path,
+    std::array<size_t, kMaxHeight>& ranks) {
+  ListHook* hook = end_hook();
+  size_t position = 0;
+  for (unsigned level = height_ - 1; level > 0; --level) {
+    for (Level* step = &link(hook, level);
+         step->next != nullptr && position + step->width < rank;
+         step = &link(hook, level)) {
+      position += step->width;
+      hook = step->next;
+    }
+    path[level] = hook;
+    ranks[level] = position;
+  }
+  for (; position + 1 < rank; ++position) {
+    hook = hook->next;
+  }
+  return hook;
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+typename IndexedList<T, Alloc>::Node* IndexedList<T, Alloc>::create_node(
+    Args&&... args) {
+  unsigned height = random_height();
+  Node* node = NodeTraits::allocate(allocator_, node_units(height));
+  try {
+    NodeTraits::construct(allocator_, &node->object,
+                          std::forward<Args>(args)...);
+  } catch (...) {
+    NodeTraits::deallocate(allocator_, node, node_units(height));
+    throw;
+  }
+  node->height = height;
+  return node;
+}
+
+template <typename T, typename Alloc>
+void IndexedList<T, Alloc>::destroy_node(ListHook* hook) {
+  Node* node = static_cast<Node*>(hook);
+  unsigned height = node->height;
+  NodeTraits::destroy(allocator_, &node->object);
+  NodeTraits::deallocate(allocator_, node, node_units(height));
+}
+
+template <typename T, typename Alloc>
+void IndexedList<T, Alloc>::relink_sentinel() {
+  if (size_ == 0) {
+    sentinel_.prev = sentinel_.next = &sentinel_;
+  } else {
+    sentinel_.next->prev = &sentinel_;
+    sentinel_.prev->next = &sentinel_;
+  }
+}
+
+template <typename T, typename Alloc>
+void IndexedList<T, Alloc>::swap(IndexedList& other) {
+  std::swap(sentinel_, other.sentinel_);
+  std::swap(head_levels_, other.head_levels_);
+  std::swap(height_, other.height_);
+  std::swap(size_, other.size_);
+  std::swap(random_, other.random_);
+  relink_sentinel();
+  other.relink_sentinel();
+}
+
+template <typename T, typename Alloc>
+IndexedList<T, Alloc>::IndexedList(std::initializer_list<T> elements,
+                                   Alloc allocator)
+    : allocator_(allocator) {
+  try {
+    for (const T& element : elements) {
+      push_back(element);
+    }
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc>
+IndexedList<T, Alloc>::~IndexedList() {
+  clear();
+}
+
+template <typename T, typename Alloc>
+IndexedList<T, Alloc>::IndexedList(const IndexedList& other)
+    : allocator_(
+          NodeTraits::select_on_container_copy_construction(other.allocator_)) {
+  try {
+    for (const T& element : other) {
+      push_back(element);
+    }
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc>
+IndexedList<T, Alloc>::IndexedList(IndexedList&& other) noexcept
+    : allocator_(std::move(other.allocator_)) {
+  swap(other);
+}
+
+template <typename T, typename Alloc>
+IndexedList<T, Alloc>& IndexedList<T, Alloc>::operator=(
+    const IndexedList& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // the copy is built by the allocator this list ends up with and the old
+  // nodes leave together with the allocator that made them
+  constexpr bool kPropagate =
+      NodeTraits::propagate_on_container_copy_assignment::value;
+  IndexedList new_list(allocator_);
+  if constexpr (kPropagate) {
+    new_list.allocator_ = other.allocator_;
+  }
+  for (const T& element : other) {
+    new_list.push_back(element);
+  }
+  if constexpr (kPropagate) {
+    std::swap(allocator_, new_list.allocator_);
+  }
+  swap(new_list);
+  return *this;
+}
+
+template <typename T, typename Alloc>
+IndexedList<T, Alloc>& IndexedList<T, Alloc>::operator=(
+    IndexedList&& other) noexcept(
+    NodeTraits::propagate_on_container_move_assignment::value ||
+    NodeTraits::is_always_equal::value) {
+  if (this == &other) {
+    return *this;
+  }
+  if constexpr (NodeTraits::propagate_on_container_move_assignment::value) {
+    IndexedList new_list(std::move(other));
+    std::swap(allocator_, new_list.allocator_);
+    swap(new_list);
+  } else if (allocator_ == other.allocator_) {
+    IndexedList new_list(std::move(other));
+    swap(new_list);
+  } else {
+    clear();
+    for (T& element : other) {
+      push_back(std::move(element));
+    }
+    other.clear();
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc>
+void IndexedList<T, Alloc>::clear() {
+  ListHook* hook = sentinel_.next;
+  while (hook != &sentinel_) {
+    ListHook* next = hook->next;
+    destroy_node(hook);
+    hook = next;
+  }
+  sentinel_.prev = sentinel_.next = &sentinel_;
+  height_ = 1;
+  size_ = 0;
+}
+
+template <typename T, typename Alloc>
+T& IndexedList<T, Alloc>::at(size_t index) {
+  if (index >= size_) {
+    throw std::out_of_range("IndexedList::at");
+  }
+  return (*this)[index];
+}
+
+template <typename T, typename Alloc>
+const T& IndexedList<T, Alloc>::at(size_t index) const {
+  if (index >= size_) {
+    throw std::out_of_range("IndexedList::at");
+  }
+  return (*this)[index];
+}
+
+// Climbs towards the end, always along the highest link of the current
+// node, and counts the positions left to the end
+template <typename T, typename Alloc>
+size_t IndexedList<T, Alloc>::index_of(const_iterator it) const {
+  auto* self = const_cast<IndexedList*>(this);
+  ListHook* hook = it.ptr;
+  size_t to_end = 0;
+  while (hook != &sentinel_) {
+    unsigned height = height_of(hook);
+    if (height == 1) {
+      hook = hook->next;
+      ++to_end;
+      continue;
+    }
+    Level& top = self->link(hook, height - 1);
+    to_end += top.width;
+    if (top.next == nullptr) {
+      break;
+    }
+    hook = top.next;
+  }
+  return size_ - to_end;
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+typename IndexedList<T, Alloc>::iterator IndexedList<T, Alloc>::emplace_at(
+    size_t index, Args&&... args) {
+  Node* node = create_node(std::forward<Args>(args)...);
+  unsigned height = node->height;
+  for (; height_ < height; ++height_) {
+    head_levels_[height_ - 1] = Level{nullptr, size_ + 1};
+  }
+  std::array<ListHook*, kMaxHeight> path;
+  std::array<size_t, kMaxHeight> ranks;
+  size_t rank = index + 1;
+  ListHook* prev = find_path(rank, path, ranks);
+
+  for (unsigned level = 1; level < height_; ++level) {
+    Level& before = link(path[level], level);
+    if (level < height) {
+      link(node, level) =
+          Level{before.next, ranks[level] + before.width - index};
+      before = Level{node, rank - ranks[level]};
+    } else {
+      ++before.width;
+    }
+  }
+  node->prev = prev;
+  node->next = prev->next;
+  prev->next->prev = node;
+  prev->next = node;
+  ++size_;
+  return iterator(node);
+}
+
+template <typename T, typename Alloc>
+void IndexedList<T, Alloc>::erase_at(size_t index) {
+  std::array<ListHook*, kMaxHeight> path;
+  std::array<size_t, kMaxHeight> ranks;
+  ListHook* prev = find_path(index + 1, path, ranks);
+  ListHook* hook = prev->next;
+  unsigned height = height_of(hook);
+
+  for (unsigned level = 1; level < height_; ++level) {
+    Level& before = link(path[level], level);
+    if (level < height) {
+      Level& erased = link(hook, level);
+      before = Level{erased.next, before.width + erased.width - 1};
+    } else {
+      --before.width;
+    }
+  }
+  prev->next = hook->next;
+  hook->next->prev = prev;
+  --size_;
+  destroy_node(hook);
+}
+
+template <typename T, typename Alloc>
+typename IndexedList<T, Alloc>::iterator IndexedList<T, Alloc>::erase(
+    const_iterator it) {
+  ListHook* next = it.ptr->next;
+  erase_at(index_of(it));
+  return iterator(next);
+}
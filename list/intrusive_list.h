@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "list+stackallocator.h"
+
+// Non-owning list of objects linked through a ListHook member, e.g.
+//
+//   struct Session { ListHook hook; ... };
+//   IntrusiveList<Session, &Session::hook> active;
+//
+// Linking and unlinking never allocate and never copy the objects. An object
+// may sit in several lists at once through several hooks, but in at most one
+// list per hook, and it must stay in place while it is linked. A hook that is
+// not linked anywhere has null prev and next.
+template <typename T, ListHook T::*Hook>
+class IntrusiveList {
+ private:
+  struct HookAccess {
+    using value_type = T;
+    static T& value(ListHook* hook);
+  };
+
+  ListHook sentinel_{&sentinel_, &sentinel_};
+
+  size_t size_ = 0;
+
+  static ListHook* hook(T& element) { return &(element.*Hook); }
+  static std::ptrdiff_t hook_offset();
+  ListHook* end_hook() const { return const_cast<ListHook*>(&sentinel_); }
+  void link_before(ListHook* pos, ListHook* node);
+  void unlink(ListHook* node);
+  void steal(IntrusiveList& other);
+
+ public:
+  using iterator = HookIterator<HookAccess, false>;
+  using const_iterator = HookIterator<HookAccess, true>;
+  using reverse_iterator = HookReverseIterator<iterator>;
+  using const_reverse_iterator = HookReverseIterator<const_iterator>;
+
+  IntrusiveList() = default;
+  ~IntrusiveList();
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+  IntrusiveList(IntrusiveList&& other) noexcept;
+  IntrusiveList& operator=(IntrusiveList&& other) noexcept;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // unlinks every element, the objects themselves are left alone
+  void clear();
+  T& front() { return HookAccess::value(sentinel_.next); }
+  T& back() { return HookAccess::value(sentinel_.prev); }
+  void push_back(T& element);
+  void push_front(T& element);
+  void pop_back();
+  void pop_front();
+  iterator insert(const_iterator it, T& element);
+  iterator erase(const_iterator it);
+  // O(1) removal straight from the object, it must be linked into this list
+  void unlink(T& element);
+  static bool is_linked(const T& element);
+  static iterator iterator_to(T& element);
+  void splice(const_iterator pos, IntrusiveList& other);
+
+  iterator begin() { return iterator(sentinel_.next); }
+  iterator end() { return iterator(&sentinel_); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cbegin() const { return const_iterator(sentinel_.next); }
+  const_iterator cend() const { return const_iterator(end_hook()); }
+  reverse_iterator rbegin() { return iterator(sentinel_.prev); }
+  reverse_iterator rend() { return iterator(&sentinel_); }
+  const_reverse_iterator rbegin() const { return crbegin(); }
+  const_reverse_iterator rend() const { return crend(); }
+  const_reverse_iterator crbegin() const {
+    return const_iterator(sentinel_.prev);
+  }
+  const_reverse_iterator crend() const { return const_iterator(end_hook()); }
+};
+
+// Position of the hook inside T, folds to a constant once optimized
+template <typename T, ListHook T::*Hook>
+std::ptrdiff_t IntrusiveList<T, Hook>::hook_offset() {
+  alignas(T) unsigned char probe[sizeof(T)];
+  T* object = reinterpret_cast<T*>(probe);
+  return reinterpret_cast<unsigned char*>(&(object->*Hook)) - probe;
+}
+
+template <typename T, ListHook T::*Hook>
+T& IntrusiveList<T, Hook>::HookAccess::value(ListHook* hook) {
+  return *reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(hook) -
+                               hook_offset());
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::link_before(ListHook* pos, ListHook* node) {
+  node->prev = pos->prev;
+  node->next = pos;
+  pos->prev->next = node;
+  pos->prev = node;
+  ++size_;
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::unlink(ListHook* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = nullptr;
+  node->next = nullptr;
+  --size_;
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::steal(IntrusiveList& other) {
+  if (other.size_ == 0) {
+    return;
+  }
+  sentinel_ = std::exchange(other.sentinel_, {&other.sentinel_,
+                                              &other.sentinel_});
+  size_ = std::exchange(other.size_, 0);
+  sentinel_.next->prev = &sentinel_;
+  sentinel_.prev->next = &sentinel_;
+}
+
+template <typename T, ListHook T::*Hook>
+IntrusiveList<T, Hook>::~IntrusiveList() {
+  clear();
+}
+
+template <typename T, ListHook T::*Hook>
+IntrusiveList<T, Hook>::IntrusiveList(IntrusiveList&& other) noexcept {
+  steal(other);
+}
+
+template <typename T, ListHook T::*Hook>
+IntrusiveList<T, Hook>& IntrusiveList<T, Hook>::operator=(
+    IntrusiveList&& other) noexcept {
+  if (this != &other) {
+    clear();
+    steal(other);
+  }
+  return *this;
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::clear() {
+  while (size_ > 0) {
+    unlink(sentinel_.next);
+  }
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::push_back(T& element) {
+  link_before(&sentinel_, hook(element));
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::push_front(T& element) {
+  link_before(sentinel_.next, hook(element));
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::pop_back() {
+  unlink(sentinel_.prev);
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::pop_front() {
+  unlink(sentinel_.next);
+}
+
+template <typename T, ListHook T::*Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::insert(
+    const_iterator it, T& element) {
+  link_before(it.ptr, hook(element));
+  return iterator(hook(element));
+}
+
+template <typename T, ListHook T::*Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::erase(
+    const_iterator it) {
+  iterator next(it.ptr->next);
+  unlink(it.ptr);
+  return next;
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::unlink(T& element) {
+  unlink(hook(element));
+}
+
+template <typename T, ListHook T::*Hook>
+bool IntrusiveList<T, Hook>::is_linked(const T& element) {
+  return (element.*Hook).next != nullptr;
+}
+
+template <typename T, ListHook T::*Hook>
+typename IntrusiveList<T, Hook>::iterator IntrusiveList<T, Hook>::iterator_to(
+    T& element) {
+  return iterator(hook(element));
+}
+
+template <typename T, ListHook T::*Hook>
+void IntrusiveList<T, Hook>::splice(const_iterator pos, IntrusiveList& other) {
+  if (&other == this || other.size_ == 0) {
+    return;
+  }
+  ListHook* first = other.sentinel_.next;
+  ListHook* last = other.sentinel_.prev;
+  other.sentinel_.next = &other.sentinel_;
+  other.sentinel_.prev = &other.sentinel_;
+  first->prev = pos.ptr->prev;
+  last->next = pos.ptr;
+  pos.ptr->prev->next = first;
+  pos.ptr->prev = last;
+  size_ += std::exchange(other.size_, 0);
+}
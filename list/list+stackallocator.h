@@ -1,18 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+inline constexpr size_t kCacheLineSize = 64;
+inline constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Bump step shared by the arenas: returns the next block of size bytes
+// aligned to align (a power of two) and advances offset, or nullptr if the
+// buffer is full. Pads only up to the next multiple of align.
+inline void* bump_allocate(char* buffer, size_t capacity, size_t& offset,
+                           size_t size, size_t align) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(buffer + offset);
+  size_t padding = (~address + 1) & (align - 1);
+  if (padding > capacity - offset || size > capacity - offset - padding) {
+    return nullptr;
+  }
+  offset += padding;
+  void* result = buffer + offset;
+  offset += size;
+  return result;
+}
 
+// Bump arena over an inline buffer. Buffers of a huge page and more are
+// aligned to a huge page so the kernel can back them with one, smaller ones
+// to a cache line.
 template <size_t N>
 struct StackStorage {
+  static constexpr size_t alignment =
+      (N >= kHugePageSize) ? kHugePageSize : kCacheLineSize;
+
   StackStorage() {}
   ~StackStorage() {}
-  char stack_storage[N];
-  int offset = 0;
+  alignas(alignment) char stack_storage[N];
+  size_t offset = 0;
+
+  // Pads only up to the next multiple of align (a power of two)
+  void* allocate_bytes(size_t size, size_t align);
+  // Grows the block in place if it is the last one handed out
+  bool extend_bytes(void* ptr, size_t size, size_t new_size);
+
+  // Everything allocated after checkpoint() is released at once by
+  // rewind(mark), see ArenaScope
+  using Mark = size_t;
+  Mark checkpoint() const { return offset; }
+  void rewind(Mark mark) { offset = mark; }
 
  private:
   StackStorage(const StackStorage&) {}
   StackStorage& operator=(const StackStorage&) {}
 };
 
+template <size_t N>
+void* StackStorage<N>::allocate_bytes(size_t size, size_t align) {
+  void* result = bump_allocate(stack_storage, N, offset, size, align);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+template <size_t N>
+bool StackStorage<N>::extend_bytes(void* ptr, size_t size, size_t new_size) {
+  char* block = static_cast<char*>(ptr);
+  if (block + size != stack_storage + offset ||
+      new_size > N - static_cast<size_t>(block - stack_storage)) {
+    return false;
+  }
+  offset = static_cast<size_t>(block - stack_storage) + new_size;
+  return true;
+}
+
 template <typename T, size_t N>
 struct StackAllocator {
   StackStorage<N>& stack;
@@ -21,11 +93,16 @@ struct StackAllocator {
   using void_pointer = void*;
   using size_type = size_t;
   using difference_type = int;
+  using is_bump_allocator = std::true_type;
 
   ~StackAllocator() {}
   StackAllocator(StackStorage<N>& storage) : stack(storage) {}
   T* allocate(size_t count);
   void deallocate(T* ptr, size_t count);
+  bool extend(T* ptr, size_t count, size_t new_count) {
+    return new_count <= N / sizeof(T) &&
+           stack.extend_bytes(ptr, count * sizeof(T), new_count * sizeof(T));
+  }
   template <typename U>
   struct rebind {
     using other = StackAllocator<U, N>;
@@ -41,16 +118,10 @@ struct StackAllocator {
 
 template <typename T, size_t N>
 T* StackAllocator<T, N>::allocate(size_t count) {
-  size_t address =
-      reinterpret_cast<uintptr_t>(stack.stack_storage + stack.offset);
-  size_t mod = address % alignof(T);
-  stack.offset += alignof(T) - mod;
-  if (stack.offset + count * sizeof(T) > N) {
+  if (count > N / sizeof(T)) {
     throw std::bad_alloc();
   }
-  T* result = reinterpret_cast<T*>(stack.stack_storage + stack.offset);
-  stack.offset += count * sizeof(T);
-  return result;
+  return static_cast<T*>(stack.allocate_bytes(count * sizeof(T), alignof(T)));
 }
 
 template <typename T, size_t N>
@@ -76,34 +147,844 @@ bool operator!=(const StackAllocator<T, N>& first,
   return !(first == second);
 }
 
+// Growable arena: a chain of heap chunks with a lock-free bump pointer, so one
+// storage can be shared by many threads. Exhausting a chunk takes the next
+// one instead of throwing, memory is returned only by reset() or destruction.
+class ChunkedStackStorage {
+ public:
+  static constexpr size_t kDefaultChunkSize = 1 << 20;
+  static constexpr size_t kChunkAlignment = kCacheLineSize;
+
+  explicit ChunkedStackStorage(size_t chunk_size = kDefaultChunkSize);
+  ~ChunkedStackStorage();
+  void* allocate_bytes(size_t size, size_t align);
+  // Rewinds every chunk at once, must not race with allocate_bytes
+  void reset();
+  [[nodiscard]] size_t chunks_count() const;
+
+  struct Mark {
+    const void* chunk;
+    size_t offset;
+  };
+  // Like reset(), rewind must not race with allocate_bytes. Chunks past the
+  // mark are kept for reuse, so both are O(1).
+  Mark checkpoint() const;
+  void rewind(Mark mark);
+
+ private:
+  struct Chunk {
+    Chunk* next = nullptr;
+    size_t capacity = 0;
+    std::atomic<size_t> offset = 0;
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+  };
+
+  Chunk* first_ = nullptr;
+  std::atomic<Chunk*> current_ = nullptr;
+  std::mutex grow_mutex_;
+  size_t chunk_size_;
+
+  static Chunk* new_chunk(size_t capacity);
+  void* try_allocate(Chunk* chunk, size_t size, size_t align);
+  ChunkedStackStorage(const ChunkedStackStorage&) = delete;
+  ChunkedStackStorage& operator=(const ChunkedStackStorage&) = delete;
+};
+
+inline ChunkedStackStorage::ChunkedStackStorage(size_t chunk_size)
+    : chunk_size_(chunk_size) {
+  first_ = new_chunk(chunk_size_);
+  current_.store(first_);
+}
+
+inline ChunkedStackStorage::~ChunkedStackStorage() {
+  while (first_ != nullptr) {
+    Chunk* next = first_->next;
+    first_->~Chunk();
+    ::operator delete(first_, std::align_val_t(kChunkAlignment));
+    first_ = next;
+  }
+}
+
+inline ChunkedStackStorage::Chunk* ChunkedStackStorage::new_chunk(
+    size_t capacity) {
+  void* memory = ::operator new(sizeof(Chunk) + capacity,
+                                std::align_val_t(kChunkAlignment));
+  Chunk* chunk = new (memory) Chunk();
+  chunk->capacity = capacity;
+  return chunk;
+}
+
+inline void* ChunkedStackStorage::try_allocate(Chunk* chunk, size_t size,
+                                               size_t align) {
+  uintptr_t base = reinterpret_cast<uintptr_t>(chunk->data());
+  size_t offset = chunk->offset.load(std::memory_order_relaxed);
+  while (true) {
+    size_t aligned = ((base + offset + align - 1) & ~(align - 1)) - base;
+    if (aligned > chunk->capacity || size > chunk->capacity - aligned) {
+      return nullptr;
+    }
+    if (chunk->offset.compare_exchange_weak(offset, aligned + size,
+                                            std::memory_order_relaxed)) {
+      return chunk->data() + aligned;
+    }
+  }
+}
+
+inline void* ChunkedStackStorage::allocate_bytes(size_t size, size_t align) {
+  // a chunk of size + align bytes plus its header must not wrap
+  if (size > SIZE_MAX - sizeof(Chunk) - align) {
+    throw std::bad_alloc();
+  }
+  while (true) {
+    Chunk* chunk = current_.load(std::memory_order_acquire);
+    if (void* result = try_allocate(chunk, size, align)) {
+      return result;
+    }
+    std::lock_guard<std::mutex> lock(grow_mutex_);
+    if (current_.load(std::memory_order_relaxed) != chunk) {
+      continue;
+    }
+    // chunks past the current one are always free, even if a reset or a
+    // rewind left their offsets behind
+    Chunk* next = chunk->next;
+    if (next == nullptr || next->capacity < size + align) {
+      next = new_chunk(std::max(chunk_size_, size + align));
+      next->next = chunk->next;
+      chunk->next = next;
+    }
+    next->offset.store(0, std::memory_order_relaxed);
+    current_.store(next, std::memory_order_release);
+  }
+}
+
+inline void ChunkedStackStorage::reset() {
+  rewind(Mark{first_, 0});
+}
+
+inline ChunkedStackStorage::Mark ChunkedStackStorage::checkpoint() const {
+  Chunk* chunk = current_.load(std::memory_order_acquire);
+  return Mark{chunk, chunk->offset.load(std::memory_order_relaxed)};
+}
+
+inline void ChunkedStackStorage::rewind(Mark mark) {
+  Chunk* chunk = const_cast<Chunk*>(static_cast<const Chunk*>(mark.chunk));
+  chunk->offset.store(mark.offset, std::memory_order_relaxed);
+  current_.store(chunk, std::memory_order_release);
+}
+
+inline size_t ChunkedStackStorage::chunks_count() const {
+  size_t count = 0;
+  for (Chunk* chunk = first_; chunk != nullptr; chunk = chunk->next) {
+    ++count;
+  }
+  return count;
+}
+
+template <typename T>
+struct ChunkedStackAllocator {
+  ChunkedStackStorage* storage;
+
+  using value_type = T;
+  using void_pointer = void*;
+  using size_type = size_t;
+  using difference_type = int;
+  using is_bump_allocator = std::true_type;
+
+  ChunkedStackAllocator(ChunkedStackStorage& storage) : storage(&storage) {}
+  template <typename U>
+  ChunkedStackAllocator(const ChunkedStackAllocator<U>& other)
+      : storage(other.storage) {}
+  T* allocate(size_t count) {
+    if (count > SIZE_MAX / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(
+        storage->allocate_bytes(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, size_t) {}
+  template <typename U>
+  struct rebind {
+    using other = ChunkedStackAllocator<U>;
+  };
+};
+
+template <typename T, typename U>
+bool operator==(const ChunkedStackAllocator<T>& first,
+                const ChunkedStackAllocator<U>& second) {
+  return first.storage == second.storage;
+}
+
+template <typename T, typename U>
+bool operator!=(const ChunkedStackAllocator<T>& first,
+                const ChunkedStackAllocator<U>& second) {
+  return !(first == second);
+}
+
+// Releases everything allocated from the arena during its lifetime when it
+// goes out of scope. Containers using the arena have to be declared after
+// the scope so that they are gone first; those of trivially destructible
+// elements over a bump allocator are then dropped in O(1).
+//
+//   {
+//     ArenaScope scope(storage);
+//     List<int, StackAllocator<int, N>> scratch(alloc);
+//     ...
+//   }  // scratch, then every byte it took from storage
+template <typename Storage>
+class ArenaScope {
+ public:
+  explicit ArenaScope(Storage& storage)
+      : storage_(storage), mark_(storage.checkpoint()) {}
+  ~ArenaScope() { storage_.rewind(mark_); }
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  Storage& storage_;
+  typename Storage::Mark mark_;
+};
+
+// std::pmr::memory_resource over a bump arena whose capacity is chosen at
+// run time, so pmr containers share one type whatever the arena size.
+// Requests that no longer fit are passed to the upstream resource and given
+// back to it on deallocation; arena blocks are released only by rewind().
+class ArenaResource : public std::pmr::memory_resource {
+ public:
+  using Mark = size_t;
+
+  // takes the arena buffer itself from upstream
+  explicit ArenaResource(
+      size_t capacity,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+  // works in a caller-owned buffer, e.g. one on the stack
+  ArenaResource(
+      void* buffer, size_t capacity,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+  ~ArenaResource() override;
+  ArenaResource(const ArenaResource&) = delete;
+  ArenaResource& operator=(const ArenaResource&) = delete;
+
+  size_t capacity() const { return capacity_; }
+  size_t used() const { return offset_; }
+  // requests that went to upstream so far
+  size_t upstream_allocations() const { return upstream_allocations_; }
+  std::pmr::memory_resource* upstream() const { return upstream_; }
+  Mark checkpoint() const { return offset_; }
+  void rewind(Mark mark) { offset_ = mark; }
+
+ private:
+  static constexpr size_t kBufferAlignment = kCacheLineSize;
+
+  char* buffer_;
+  size_t capacity_;
+  size_t offset_ = 0;
+  size_t upstream_allocations_ = 0;
+  std::pmr::memory_resource* upstream_;
+  bool owns_buffer_;
+
+  bool in_arena(void* ptr) const {
+    char* address = static_cast<char*>(ptr);
+    return address >= buffer_ && address < buffer_ + capacity_;
+  }
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+inline ArenaResource::ArenaResource(size_t capacity,
+                                    std::pmr::memory_resource* upstream)
+    : buffer_(static_cast<char*>(
+          upstream->allocate(capacity, kBufferAlignment))),
+      capacity_(capacity),
+      upstream_(upstream),
+      owns_buffer_(true) {}
+
+inline ArenaResource::ArenaResource(void* buffer, size_t capacity,
+                                    std::pmr::memory_resource* upstream)
+    : buffer_(static_cast<char*>(buffer)),
+      capacity_(capacity),
+      upstream_(upstream),
+      owns_buffer_(false) {}
+
+inline ArenaResource::~ArenaResource() {
+  if (owns_buffer_) {
+    upstream_->deallocate(buffer_, capacity_, kBufferAlignment);
+  }
+}
+
+inline void* ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+  if (void* result =
+          bump_allocate(buffer_, capacity_, offset_, bytes, alignment)) {
+    return result;
+  }
+  ++upstream_allocations_;
+  return upstream_->allocate(bytes, alignment);
+}
+
+inline void ArenaResource::do_deallocate(void* ptr, size_t bytes,
+                                         size_t alignment) {
+  if (!in_arena(ptr)) {
+    upstream_->deallocate(ptr, bytes, alignment);
+  }
+}
+
+// Size-class pool: small blocks are carved from heap chunks and recycled
+// through one intrusive free list per class, so allocate/deallocate are O(1)
+// and churning containers stop growing. Larger blocks go to operator new.
+// Chunks are aligned to their size, so the pool owning a small block can be
+// found from the block address alone.
+class PoolStorage {
+ public:
+  static constexpr size_t kGranularity = 8;
+  static constexpr size_t kClassesCount = 64;
+  static constexpr size_t kMaxBlockSize = kGranularity * kClassesCount;
+  static constexpr size_t kMaxAlignment = kCacheLineSize;
+  static constexpr size_t kChunkSize = 1 << 16;
+
+  PoolStorage() = default;
+  ~PoolStorage();
+  void* allocate_bytes(size_t size, size_t align);
+  void deallocate_bytes(void* ptr, size_t size, size_t align);
+  [[nodiscard]] size_t chunks_count() const;
+  static size_t block_size(size_t size, size_t align);
+  static bool is_small(size_t size, size_t align) {
+    // size is checked first so that rounding it up in block_size cannot wrap
+    return size <= kMaxBlockSize && align <= kMaxAlignment &&
+           block_size(size, align) <= kMaxBlockSize;
+  }
+  // only for blocks that is_small() sends to the chunks
+  static PoolStorage* owner_of(void* ptr);
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+  struct Chunk {
+    Chunk* next;
+    PoolStorage* owner;
+  };
+
+  std::array<FreeBlock*, kClassesCount> free_lists_{};
+  Chunk* chunks_ = nullptr;
+  char* cursor_ = nullptr;
+  char* chunk_end_ = nullptr;
+
+  PoolStorage(const PoolStorage&) = delete;
+  PoolStorage& operator=(const PoolStorage&) = delete;
+};
+
+inline PoolStorage::~PoolStorage() {
+  while (chunks_ != nullptr) {
+    Chunk* next = chunks_->next;
+    ::operator delete(chunks_, std::align_val_t(kChunkSize));
+    chunks_ = next;
+  }
+}
+
+inline size_t PoolStorage::block_size(size_t size, size_t align) {
+  size = std::max(size, kGranularity);
+  size = (size + align - 1) / align * align;
+  return (size + kGranularity - 1) / kGranularity * kGranularity;
+}
+
+inline PoolStorage* PoolStorage::owner_of(void* ptr) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  return reinterpret_cast<Chunk*>(address & ~(kChunkSize - 1))->owner;
+}
+
+inline void* PoolStorage::allocate_bytes(size_t size, size_t align) {
+  size_t block = block_size(size, align);
+  if (!is_small(size, align)) {
+    return ::operator new(size, std::align_val_t(std::max<size_t>(
+                                    align, __STDCPP_DEFAULT_NEW_ALIGNMENT__)));
+  }
+  FreeBlock*& free_list = free_lists_[block / kGranularity - 1];
+  if (free_list != nullptr) {
+    FreeBlock* result = free_list;
+    free_list = free_list->next;
+    return result;
+  }
+  // blocks of one class are aligned to the lowest set bit of their size
+  size_t block_align = std::min(block & (~block + 1), kMaxAlignment);
+  uintptr_t address = reinterpret_cast<uintptr_t>(cursor_);
+  char* result = cursor_ + ((block_align - address % block_align) % block_align);
+  if (cursor_ == nullptr || result + block > chunk_end_) {
+    // the chunk header takes a whole alignment step to keep blocks aligned
+    void* memory = ::operator new(kChunkSize, std::align_val_t(kChunkSize));
+    chunks_ = new (memory) Chunk{chunks_, this};
+    cursor_ = static_cast<char*>(memory) + kMaxAlignment;
+    chunk_end_ = static_cast<char*>(memory) + kChunkSize;
+    result = cursor_;
+  }
+  cursor_ = result + block;
+  return result;
+}
+
+inline void PoolStorage::deallocate_bytes(void* ptr, size_t size,
+                                          size_t align) {
+  size_t block = block_size(size, align);
+  if (!is_small(size, align)) {
+    ::operator delete(ptr, std::align_val_t(std::max<size_t>(
+                               align, __STDCPP_DEFAULT_NEW_ALIGNMENT__)));
+    return;
+  }
+  FreeBlock*& free_list = free_lists_[block / kGranularity - 1];
+  free_list = new (ptr) FreeBlock{free_list};
+}
+
+inline size_t PoolStorage::chunks_count() const {
+  size_t count = 0;
+  for (Chunk* chunk = chunks_; chunk != nullptr; chunk = chunk->next) {
+    ++count;
+  }
+  return count;
+}
+
+template <typename T>
+struct PoolAllocator {
+  PoolStorage* storage;
+
+  using value_type = T;
+  using void_pointer = void*;
+  using size_type = size_t;
+  using difference_type = int;
+
+  PoolAllocator(PoolStorage& storage) : storage(&storage) {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : storage(other.storage) {}
+  T* allocate(size_t count) {
+    if (count > SIZE_MAX / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(
+        storage->allocate_bytes(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* ptr, size_t count) {
+    storage->deallocate_bytes(ptr, count * sizeof(T), alignof(T));
+  }
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U>;
+  };
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& first, const PoolAllocator<U>& second) {
+  return first.storage == second.storage;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& first, const PoolAllocator<U>& second) {
+  return !(first == second);
+}
+
+// Pool owned by one thread at a time. Other threads never touch its free
+// lists: blocks they free are pushed onto a lock-free per-class return stack,
+// which the owner drains into its free lists when it allocates that class.
+class ThreadArena : private PoolStorage {
+ public:
+  void* allocate_bytes(size_t size, size_t align);
+  // may be called from any thread
+  static void deallocate_bytes(void* ptr, size_t size, size_t align);
+  using PoolStorage::chunks_count;
+
+ private:
+  friend class ThreadArenaRegistry;
+
+  struct RemoteBlock {
+    RemoteBlock* next;
+  };
+
+  alignas(kCacheLineSize)
+      std::array<std::atomic<RemoteBlock*>, kClassesCount> remote_frees_{};
+
+  ThreadArena() = default;
+  void drain(size_t size_class, size_t block);
+};
+
+// Hands every thread an arena of its own. Arenas are never destroyed, since
+// blocks from them may outlive their thread: when a thread exits its arena
+// goes idle, keeps collecting remote frees and is adopted by the next new
+// thread.
+class ThreadArenaRegistry {
+ public:
+  static ThreadArena& local();
+  static size_t arenas_count();
+
+ private:
+  std::mutex mutex_;
+  std::vector<ThreadArena*> arenas_;
+  std::vector<ThreadArena*> idle_;
+
+  // deliberately leaked so that arenas survive static destruction
+  static ThreadArenaRegistry& instance();
+  ThreadArena* acquire();
+  void release(ThreadArena* arena);
+};
+
+inline void* ThreadArena::allocate_bytes(size_t size, size_t align) {
+  if (is_small(size, align)) {
+    size_t block = block_size(size, align);
+    size_t size_class = block / kGranularity - 1;
+    if (remote_frees_[size_class].load(std::memory_order_relaxed) != nullptr) {
+      drain(size_class, block);
+    }
+  }
+  return PoolStorage::allocate_bytes(size, align);
+}
+
+inline void ThreadArena::deallocate_bytes(void* ptr, size_t size,
+                                          size_t align) {
+  if (!is_small(size, align)) {
+    ::operator delete(ptr, std::align_val_t(std::max<size_t>(
+                               align, __STDCPP_DEFAULT_NEW_ALIGNMENT__)));
+    return;
+  }
+  auto* owner = static_cast<ThreadArena*>(owner_of(ptr));
+  if (owner == &ThreadArenaRegistry::local()) {
+    owner->PoolStorage::deallocate_bytes(ptr, size, align);
+    return;
+  }
+  std::atomic<RemoteBlock*>& stack =
+      owner->remote_frees_[block_size(size, align) / kGranularity - 1];
+  auto* block = new (ptr) RemoteBlock{stack.load(std::memory_order_relaxed)};
+  while (!stack.compare_exchange_weak(block->next, block,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+// Only the owner pops, and it takes the whole stack at once, so there is no
+// ABA problem
+inline void ThreadArena::drain(size_t size_class, size_t block) {
+  RemoteBlock* head =
+      remote_frees_[size_class].exchange(nullptr, std::memory_order_acquire);
+  while (head != nullptr) {
+    RemoteBlock* next = head->next;
+    PoolStorage::deallocate_bytes(head, block, 1);
+    head = next;
+  }
+}
+
+inline ThreadArenaRegistry& ThreadArenaRegistry::instance() {
+  static ThreadArenaRegistry* registry = new ThreadArenaRegistry();
+  return *registry;
+}
+
+inline ThreadArena& ThreadArenaRegistry::local() {
+  struct Handle {
+    ThreadArena* arena = instance().acquire();
+    ~Handle() { instance().release(arena); }
+  };
+  thread_local Handle handle;
+  return *handle.arena;
+}
+
+inline size_t ThreadArenaRegistry::arenas_count() {
+  ThreadArenaRegistry& registry = instance();
+  std::lock_guard lock(registry.mutex_);
+  return registry.arenas_.size();
+}
+
+inline ThreadArena* ThreadArenaRegistry::acquire() {
+  std::lock_guard lock(mutex_);
+  if (!idle_.empty()) {
+    ThreadArena* arena = idle_.back();
+    idle_.pop_back();
+    return arena;
+  }
+  arenas_.push_back(new ThreadArena());
+  return arenas_.back();
+}
+
+inline void ThreadArenaRegistry::release(ThreadArena* arena) {
+  std::lock_guard lock(mutex_);
+  idle_.push_back(arena);
+}
+
+// Stateless allocator over the calling thread's arena. All instances compare
+// equal, so containers may be moved, spliced and destroyed across threads.
+template <typename T>
+struct ThreadLocalAllocator {
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  ThreadLocalAllocator() = default;
+  template <typename U>
+  ThreadLocalAllocator(const ThreadLocalAllocator<U>&) {}
+  T* allocate(size_t count) {
+    if (count > SIZE_MAX / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(ThreadArenaRegistry::local().allocate_bytes(
+        count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* ptr, size_t count) {
+    ThreadArena::deallocate_bytes(ptr, count * sizeof(T), alignof(T));
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const ThreadLocalAllocator<T>&,
+                const ThreadLocalAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const ThreadLocalAllocator<T>&,
+                const ThreadLocalAllocator<U>&) {
+  return false;
+}
+
+// Allocators whose deallocate ignores its arguments: nodes taken from one
+// allocate(n) call may then be released one by one, so containers can
+// request them in batches. An allocator opts in with a nested
+// is_bump_allocator type, the way it sets the propagate_on_container_* tags,
+// so wrappers can forward it from the allocator they wrap.
+template <typename Alloc>
+struct is_bump_allocator : std::false_type {};
+
+template <typename Alloc>
+  requires requires { typename Alloc::is_bump_allocator; }
+struct is_bump_allocator<Alloc>
+    : std::bool_constant<Alloc::is_bump_allocator::value> {};
+
+template <typename Alloc>
+inline constexpr bool is_bump_allocator_v = is_bump_allocator<Alloc>::value;
+
+// Links of a circular doubly linked list. Every List owns one hook as the
+// sentinel, so the list is never empty of links and splices need no branches.
+struct ListHook {
+  ListHook* prev = nullptr;
+  ListHook* next = nullptr;
+};
+
+// Bidirectional iterator over a ring of hooks. Access maps a hook to the
+// element holding it: List reaches into its nodes, IntrusiveList into the
+// user's objects.
+template <typename Access, bool IsConst>
+class HookIterator {
+ public:
+  using T = typename Access::value_type;
+
+  ListHook* ptr = nullptr;
+  using value_type = T;
+  using difference_type = int;
+  using reference = typename std::conditional<IsConst, const T&, T&>::type;
+  using pointer = typename std::conditional<IsConst, const T*, T*>::type;
+  using iterator_category = std::bidirectional_iterator_tag;
+  HookIterator() = default;
+  explicit HookIterator(ListHook* ptr_input) : ptr(ptr_input) {}
+  reference operator*() const;
+  pointer operator->() const;
+  HookIterator& operator++();
+  HookIterator operator++(int);
+  HookIterator& operator--();
+  HookIterator operator--(int);
+  bool operator==(const HookIterator& other) const;
+  bool operator!=(const HookIterator& other) const;
+  operator HookIterator<Access, true>() const {
+    return HookIterator<Access, true>(ptr);
+  }
+};
+
+template <class Iterator>
+class HookReverseIterator {
+ private:
+  Iterator iter_;
+
+ public:
+  using value_type = typename Iterator::value_type;
+  using difference_type = int;
+  using reference = typename Iterator::reference;
+  using pointer = typename Iterator::pointer;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  HookReverseIterator(const Iterator& iter_constr) : iter_(iter_constr) {}
+  typename Iterator::reference operator*();
+  Iterator operator->();
+  HookReverseIterator& operator++();
+  HookReverseIterator& operator--();
+  HookReverseIterator operator++(int);
+  HookReverseIterator operator--(int);
+  bool operator==(const HookReverseIterator& other) const;
+  bool operator!=(const HookReverseIterator& other) const;
+  Iterator base() const { return Iterator(iter_.ptr->next); }
+  template <typename Other>
+    requires std::is_convertible_v<Iterator, Other>
+  operator HookReverseIterator<Other>() const {
+    return HookReverseIterator<Other>(iter_);
+  }
+};
+
+template <typename Access, bool IsConst>
+HookIterator<Access, IsConst>& HookIterator<Access, IsConst>::operator++() {
+  ptr = ptr->next;
+  return *this;
+}
+
+template <typename Access, bool IsConst>
+HookIterator<Access, IsConst>& HookIterator<Access, IsConst>::operator--() {
+  ptr = ptr->prev;
+  return *this;
+}
+
+template <typename Access, bool IsConst>
+HookIterator<Access, IsConst> HookIterator<Access, IsConst>::operator++(int) {
+  HookIterator prev_ptr = *this;
+  ++(*this);
+  return prev_ptr;
+}
+
+template <typename Access, bool IsConst>
+HookIterator<Access, IsConst> HookIterator<Access, IsConst>::operator--(int) {
+  HookIterator prev_ptr = *this;
+  --(*this);
+  return prev_ptr;
+}
+
+template <typename Access, bool IsConst>
+bool HookIterator<Access, IsConst>::operator==(
+    const HookIterator& other) const {
+  return ptr == other.ptr;
+}
+
+template <typename Access, bool IsConst>
+bool HookIterator<Access, IsConst>::operator!=(
+    const HookIterator& other) const {
+  return !(*this == other);
+}
+
+template <typename Access, bool IsConst>
+typename HookIterator<Access, IsConst>::reference
+HookIterator<Access, IsConst>::operator*() const {
+  return Access::value(ptr);
+}
+
+template <typename Access, bool IsConst>
+typename HookIterator<Access, IsConst>::pointer
+HookIterator<Access, IsConst>::operator->() const {
+  return &Access::value(ptr);
+}
+
+template <class Iterator>
+HookReverseIterator<Iterator>& HookReverseIterator<Iterator>::operator++() {
+  --iter_;
+  return *this;
+}
+
+template <class Iterator>
+HookReverseIterator<Iterator> HookReverseIterator<Iterator>::operator++(int) {
+  HookReverseIterator old_iter = *this;
+  --iter_;
+  return old_iter;
+}
+
+template <class Iterator>
+HookReverseIterator<Iterator>& HookReverseIterator<Iterator>::operator--() {
+  ++iter_;
+  return *this;
+}
+
+template <class Iterator>
+HookReverseIterator<Iterator> HookReverseIterator<Iterator>::operator--(int) {
+  HookReverseIterator old_iter = *this;
+  ++iter_;
+  return old_iter;
+}
+
+template <class Iterator>
+typename Iterator::reference HookReverseIterator<Iterator>::operator*() {
+  return *iter_;
+}
+
+template <class Iterator>
+Iterator HookReverseIterator<Iterator>::operator->() {
+  return iter_;
+}
+
+template <class Iterator>
+bool HookReverseIterator<Iterator>::operator==(
+    const HookReverseIterator& other) const {
+  return iter_ == other.iter_;
+}
+
+template <class Iterator>
+bool HookReverseIterator<Iterator>::operator!=(
+    const HookReverseIterator& other) const {
+  return !(*this == other);
+}
+
 template <typename T, typename Alloc = std::allocator<T>>
 class List {
  private:
   void swap(List& other) {
     std::swap(size_, other.size_);
-    std::swap(top_, other.top_);
-    std::swap(bottom_, other.bottom_);
+    std::swap(sentinel_, other.sentinel_);
+    relink_sentinel();
+    other.relink_sentinel();
   }
 
-  void fill_list(size_t size, T element);
+  void fill_list(size_t size, const T& element);
 
-  struct Node {
+  struct Node : ListHook {
     ~Node() = default;
 
     T object;
-    Node* prev;
-    Node* next;
   };
 
-  Node* top_ = nullptr;
-  Node* bottom_ = nullptr;
+  ListHook sentinel_{&sentinel_, &sentinel_};
 
   size_t size_ = 0;
 
   using NodeAlloc =
       typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
   [[no_unique_address]] NodeAlloc allocator_;
 
+  struct NodeAccess {
+    using value_type = T;
+    static T& value(ListHook* hook) {
+      return static_cast<Node*>(hook)->object;
+    }
+  };
+
+  static T& value(ListHook* hook) { return NodeAccess::value(hook); }
+  ListHook* end_hook() const { return const_cast<ListHook*>(&sentinel_); }
+  // points the first and last nodes back to this sentinel after it was moved
+  void relink_sentinel();
+  template <typename... Args>
+  Node* create_node(Args&&... args);
+  void destroy_node(ListHook* node);
+  // Builds count nodes with construct(T*) and links them before pos at once,
+  // bump allocators hand out the whole batch as one contiguous slab
+  template <typename Construct>
+  ListHook* link_batch(ListHook* pos, size_t count, Construct construct);
+  void link_before(ListHook* pos, ListHook* node);
+  void unlink(ListHook* node);
+  // [first, last] is an inclusive chain of count nodes
+  void link_range_before(ListHook* pos, ListHook* first, ListHook* last,
+                         size_t count);
+  void unlink_range(ListHook* first, ListHook* last, size_t count);
+  void steal(List& other);
+  // detaches all nodes as a null-terminated chain linked by next
+  ListHook* release_chain();
+  // adopts a null-terminated chain linked by next, restoring prev links
+  void adopt_chain(ListHook* first, size_t count);
+  template <typename Compare>
+  static ListHook* merge_chains(ListHook* first, ListHook* second,
+                                Compare& comp);
+  static constexpr size_t kPrefetchDistance = 8;
+  // fewest elements worth a thread of its own in parallel_for_each
+  static constexpr size_t kParallelGrain = 1 << 14;
+  // runs task(begin, end) on threads slices of [0, count), the calling
+  // thread takes the last one
+  template <typename Task>
+  static void run_split(size_t count, unsigned threads, Task task);
+
  public:
   List() = default;
   ~List();
@@ -112,75 +993,39 @@ class List {
   List(Alloc allocator);
   List(size_t size, Alloc alloc);
   List(size_t size, const T& element, Alloc allocator);
+  template <std::input_iterator InputIt>
+  List(InputIt first, InputIt last, Alloc allocator = Alloc());
+  List(std::initializer_list<T> elements, Alloc allocator = Alloc());
   List(const List& other);
+  List(List&& other) noexcept;
   List<T, Alloc>& operator=(const List<T, Alloc>& other);
+  List<T, Alloc>& operator=(List<T, Alloc>&& other) noexcept(
+      NodeTraits::propagate_on_container_move_assignment::value ||
+      NodeTraits::is_always_equal::value);
   NodeAlloc get_allocator() { return allocator_; }
   size_t size() const;
+  void clear();
   void push_back(const T& new_t);
+  void push_back(T&& new_t);
   void push_front(const T& new_t);
+  void push_front(T&& new_t);
+  template <typename... Args>
+  T& emplace_back(Args&&... args);
+  template <typename... Args>
+  T& emplace_front(Args&&... args);
   void pop_back();
   void pop_front();
-  Node* get_top() const { return top_; }
-  Node* get_bottom() const { return bottom_; }
+  Node* get_top() const {
+    return size_ == 0 ? nullptr : static_cast<Node*>(sentinel_.prev);
+  }
+  Node* get_bottom() const {
+    return size_ == 0 ? nullptr : static_cast<Node*>(sentinel_.next);
+  }
 
   template <bool IsConst>
-  class iterator_common {
-   public:
-    typename std::conditional<IsConst, const List<T, Alloc>*,
-                              List<T, Alloc>*>::type list_iter;
-    Node* ptr = nullptr;
-    using value_type = T;
-    using difference_type = int;
-    using reference = typename std::conditional<IsConst, const T&, T&>::type;
-    using pointer = typename std::conditional<IsConst, const T*, T*>::type;
-    using iterator_category = std::bidirectional_iterator_tag;
-    iterator_common(typename std::conditional<IsConst, const List<T, Alloc>*,
-                                              List<T, Alloc>*>::type list)
-        : list_iter(list), ptr(list->bottom_) {}
-    iterator_common(typename std::conditional<IsConst, const List<T, Alloc>*,
-                                              List<T, Alloc>*>::type list,
-                    Node* ptr_input)
-        : list_iter(list), ptr(ptr_input) {}
-    reference operator*();
-    pointer operator->();
-    iterator_common& operator++();
-    iterator_common operator++(int);
-    iterator_common& operator--();
-    iterator_common operator--(int);
-    bool operator==(const iterator_common<IsConst>& other) const;
-    bool operator!=(const iterator_common<IsConst>& other) const;
-    operator iterator_common<true>() { return const_iterator(list_iter, ptr); }
-  };
-
+  using iterator_common = HookIterator<NodeAccess, IsConst>;
   template <class Iterator>
-  class reverse_iterator_common {
-   private:
-    Iterator iter_;
-
-   public:
-    using value_type = T;
-    using difference_type = int;
-    using reference = typename Iterator::reference;
-    using pointer = typename Iterator::pointer;
-    using iterator_category = std::bidirectional_iterator_tag;
-
-    reverse_iterator_common(const Iterator& iter_constr) : iter_(iter_constr) {}
-    typename Iterator::reference operator*();
-    Iterator operator->();
-    reverse_iterator_common& operator++();
-    reverse_iterator_common& operator--();
-    reverse_iterator_common& operator++(int);
-    reverse_iterator_common& operator--(int);
-    bool operator==(const reverse_iterator_common& other) const;
-    bool operator!=(const reverse_iterator_common& other) const;
-    Iterator base() const {
-      Iterator iter_based(iter_.list_iter, iter_.ptr->next);
-      return iter_based;
-    }
-    operator reverse_iterator_common<iterator_common<true>>() {
-      return const_reverse_iterator(iter_);
-    }
-  };
+  using reverse_iterator_common = HookReverseIterator<Iterator>;
 
   using iterator = iterator_common<false>;
   using const_iterator = iterator_common<true>;
@@ -198,444 +1043,741 @@ class List {
   const_reverse_iterator crend() const;
   const_reverse_iterator rbegin() const;
   const_reverse_iterator rend() const;
-  void insert(const_iterator it, const T& element);
+  template <typename... Args>
+  iterator emplace(const_iterator it, Args&&... args);
+  iterator insert(const_iterator it, const T& element);
+  iterator insert(const_iterator it, T&& element);
+  template <std::input_iterator InputIt>
+  iterator insert(const_iterator it, InputIt first, InputIt last);
+  iterator insert(const_iterator it, std::initializer_list<T> elements);
   void erase(const_iterator it);
+
+  // Node relinking operations, elements are never copied or moved while both
+  // lists share an allocator and iterators keep pointing to the same elements
+  void splice(const_iterator pos, List& other);
+  void splice(const_iterator pos, List&& other);
+  void splice(const_iterator pos, List& other, const_iterator it);
+  void splice(const_iterator pos, List& other, const_iterator first,
+              const_iterator last);
+  void merge(List& other);
+  void merge(List&& other);
+  template <typename Compare>
+  void merge(List& other, Compare comp);
+  // stable bottom-up merge sort, O(n log n) and no allocations
+  void sort();
+  template <typename Compare>
+  void sort(Compare comp);
+  void reverse() noexcept;
+  size_t unique();
+  template <typename BinaryPredicate>
+  size_t unique(BinaryPredicate pred);
+
+  // Calls f on every element in order while prefetching the node
+  // kPrefetchDistance links ahead, so its cache miss overlaps the work on
+  // the nodes in between
+  template <typename Func>
+  void for_each(Func f);
+  // Calls f on every element from up to threads threads, f must not throw
+  // and must be safe to call on different elements concurrently. When the
+  // nodes sit back to back in a StackStorage arena in list order, as fill
+  // constructors and push_back into a fresh arena leave them, the arena
+  // range is split between the threads and each one streams through its
+  // part without chasing links. Other lists fall back to for_each.
+  template <typename Func>
+  void parallel_for_each(
+      Func f, unsigned threads = std::thread::hardware_concurrency());
 };
 
 template <typename T, typename Alloc>
 List<T, Alloc>::~List() {
-  Node* tmp;
-  while (size_ > 0) {
-    tmp = bottom_;
-    bottom_ = bottom_->next;
-    std::allocator_traits<NodeAlloc>::destroy(allocator_, tmp);
-    std::allocator_traits<NodeAlloc>::deallocate(allocator_, tmp, 1);
-    --size_;
-  }
+  clear();
 }
 
 template <typename T, typename Alloc>
-void List<T, Alloc>::fill_list(size_t size, T element) {
-  for (size_t i = 0; i < size; ++i) {
-    Node* obj = allocator_.allocate(1);
-    std::allocator_traits<NodeAlloc>::construct(allocator_, &(obj->object),
-                                                element);
-    if (top_ == nullptr) {
-      top_ = obj;
-      bottom_ = obj;
-      continue;
-    }
-    top_->next = obj;
-    obj->prev = top_;
-    top_ = obj;
+void List<T, Alloc>::clear() {
+  // nothing to run per node: the memory goes back when the arena rewinds
+  if constexpr (std::is_trivially_destructible_v<Node> &&
+                is_bump_allocator_v<NodeAlloc>) {
+    sentinel_.prev = &sentinel_;
+    sentinel_.next = &sentinel_;
+    size_ = 0;
+    return;
   }
-  size_ = size;
+  ListHook* ptr = sentinel_.next;
+  while (ptr != &sentinel_) {
+    ListHook* next = ptr->next;
+    destroy_node(ptr);
+    ptr = next;
+  }
+  sentinel_.prev = &sentinel_;
+  sentinel_.next = &sentinel_;
+  size_ = 0;
 }
 
 template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t size) {
-  try {
-    fill_list(size, T());
-  } catch (...) {
-    (*this).~List();
+void List<T, Alloc>::relink_sentinel() {
+  if (size_ == 0) {
+    sentinel_.prev = &sentinel_;
+    sentinel_.next = &sentinel_;
+    return;
   }
+  sentinel_.next->prev = &sentinel_;
+  sentinel_.prev->next = &sentinel_;
 }
 
 template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t size, const T& element) {
+template <typename... Args>
+typename List<T, Alloc>::Node* List<T, Alloc>::create_node(Args&&... args) {
+  Node* node = NodeTraits::allocate(allocator_, 1);
   try {
-    fill_list(size, element);
+    NodeTraits::construct(allocator_, &(node->object),
+                          std::forward<Args>(args)...);
   } catch (...) {
-    (*this).~List();
+    NodeTraits::deallocate(allocator_, node, 1);
+    throw;
   }
+  return node;
 }
 
 template <typename T, typename Alloc>
-List<T, Alloc>::List(Alloc alloc)
-    : allocator_(std::allocator_traits<
-                 NodeAlloc>::select_on_container_copy_construction(alloc)) {}
+void List<T, Alloc>::destroy_node(ListHook* node) {
+  Node* ptr = static_cast<Node*>(node);
+  NodeTraits::destroy(allocator_, ptr);
+  NodeTraits::deallocate(allocator_, ptr, 1);
+}
 
-template <class T, class Alloc>
-List<T, Alloc>::List(size_t size, Alloc alloc) : allocator_(alloc) {
+template <typename T, typename Alloc>
+template <typename Construct>
+ListHook* List<T, Alloc>::link_batch(ListHook* pos, size_t count,
+                                     Construct construct) {
+  if (count == 0) {
+    return pos;
+  }
+  ListHook head;
+  ListHook* last = &head;
+  size_t built = 0;
   try {
-    for (size_t i = 0; i < size; ++i) {
-      Node* obj = std::allocator_traits<NodeAlloc>::allocate(allocator_, 1);
-      std::allocator_traits<NodeAlloc>::construct(allocator_, &(obj->object));
-      if (top_ == nullptr) {
-        top_ = obj;
-        bottom_ = obj;
-        continue;
+    Node* slab = nullptr;
+    if constexpr (is_bump_allocator_v<NodeAlloc>) {
+      slab = NodeTraits::allocate(allocator_, count);
+    }
+    for (; built < count; ++built) {
+      Node* node = (slab != nullptr) ? slab + built
+                                     : NodeTraits::allocate(allocator_, 1);
+      try {
+        construct(&(node->object));
+      } catch (...) {
+        if (slab == nullptr) {
+          NodeTraits::deallocate(allocator_, node, 1);
+        }
+        throw;
       }
-      top_->next = obj;
-      obj->prev = top_;
-      top_ = obj;
+      node->prev = last;
+      last->next = node;
+      last = node;
     }
-    size_ = size;
   } catch (...) {
-    (*this).~List();
+    for (ListHook* ptr = last; ptr != &head;) {
+      ListHook* prev = ptr->prev;
+      destroy_node(ptr);
+      ptr = prev;
+    }
+    throw;
   }
+  link_range_before(pos, head.next, last, count);
+  return head.next;
 }
 
 template <typename T, typename Alloc>
-List<T, Alloc>::List(size_t size, const T& element, Alloc allocator)
-    : allocator_(allocator) {
-  try {
-    fill_list(size, element);
-  } catch (...) {
-    (*this).~List();
-  }
+void List<T, Alloc>::link_before(ListHook* pos, ListHook* node) {
+  link_range_before(pos, node, node, 1);
 }
 
-template <class T, class Alloc>
-inline List<T, Alloc>::List(const List<T, Alloc>& other)
-    : allocator_(std::allocator_traits<NodeAlloc>::
-                     select_on_container_copy_construction(other.allocator_)) {
-  if (other.size() <= 0) {
+template <typename T, typename Alloc>
+void List<T, Alloc>::unlink(ListHook* node) {
+  unlink_range(node, node, 1);
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::link_range_before(ListHook* pos, ListHook* first,
+                                       ListHook* last, size_t count) {
+  first->prev = pos->prev;
+  last->next = pos;
+  pos->prev->next = first;
+  pos->prev = last;
+  size_ += count;
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::unlink_range(ListHook* first, ListHook* last,
+                                  size_t count) {
+  first->prev->next = last->next;
+  last->next->prev = first->prev;
+  size_ -= count;
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::steal(List& other) {
+  sentinel_ = other.sentinel_;
+  size_ = std::exchange(other.size_, 0);
+  relink_sentinel();
+  other.relink_sentinel();
+}
+
+template <typename T, typename Alloc>
+ListHook* List<T, Alloc>::release_chain() {
+  ListHook* first = sentinel_.next;
+  sentinel_.prev->next = nullptr;
+  sentinel_.prev = &sentinel_;
+  sentinel_.next = &sentinel_;
+  size_ = 0;
+  return (first == &sentinel_) ? nullptr : first;
+}
+
+template <typename T, typename Alloc>
+void List<T, Alloc>::adopt_chain(ListHook* first, size_t count) {
+  if (first == nullptr) {
     return;
   }
-  try {
-    Node* head = std::allocator_traits<NodeAlloc>::allocate(allocator_, 1);
-    std::allocator_traits<NodeAlloc>::construct(allocator_, &(head->object),
-                                                other.bottom_->object);
-    ++size_;
-    bottom_ = head;
-    Node* ptr = head;
-    bottom_->prev = nullptr;
-    Node* other_ptr = other.bottom_->next;
-    while (size_ < other.size()) {
-      Node* tmp = std::allocator_traits<NodeAlloc>::allocate(allocator_, 1);
-      std::allocator_traits<NodeAlloc>::construct(allocator_, &(tmp->object),
-                                                  other_ptr->object);
-      tmp->prev = ptr;
-      ptr->next = tmp;
-      ptr = tmp;
-      other_ptr = other_ptr->next;
-      ++size_;
-    }
-    top_ = ptr;
-    top_->next = nullptr;
-  } catch (...) {
-    (*this).~List();
-    throw;
+  ListHook* last = first;
+  for (ListHook* ptr = first->next; ptr != nullptr; ptr = ptr->next) {
+    ptr->prev = last;
+    last = ptr;
   }
+  link_range_before(&sentinel_, first, last, count);
 }
 
 template <typename T, typename Alloc>
-List<T, Alloc>& List<T, Alloc>::operator=(const List<T, Alloc>& other) {
-  if constexpr (std::allocator_traits<
-                    NodeAlloc>::propagate_on_container_copy_assignment::value) {
-    allocator_ = other.allocator_;
+template <typename Compare>
+ListHook* List<T, Alloc>::merge_chains(ListHook* first, ListHook* second,
+                                       Compare& comp) {
+  ListHook* head = nullptr;
+  ListHook** tail = &head;
+  while (first != nullptr && second != nullptr) {
+    // ties take the first chain to keep the merge stable
+    if (comp(value(second), value(first))) {
+      *tail = second;
+      second = second->next;
+    } else {
+      *tail = first;
+      first = first->next;
+    }
+    tail = &(*tail)->next;
   }
-  List new_list(other);
-  swap(new_list);
-  return *this;
+  *tail = (first != nullptr) ? first : second;
+  return head;
 }
 
 template <typename T, typename Alloc>
-size_t List<T, Alloc>::size() const {
-  return size_;
+void List<T, Alloc>::fill_list(size_t size, const T& element) {
+  link_batch(&sentinel_, size, [this, &element](T* place) {
+    NodeTraits::construct(allocator_, place, element);
+  });
 }
 
 template <typename T, typename Alloc>
-void List<T, Alloc>::push_back(const T& new_t) {
-  insert(--end(), new_t);
+List<T, Alloc>::List(size_t size) {
+  link_batch(&sentinel_, size,
+             [this](T* place) { NodeTraits::construct(allocator_, place); });
 }
 
 template <typename T, typename Alloc>
-void List<T, Alloc>::pop_back() {
-  erase(--end());
+List<T, Alloc>::List(size_t size, const T& element) {
+  fill_list(size, element);
 }
 
 template <typename T, typename Alloc>
-void List<T, Alloc>::push_front(const T& new_t) {
-  insert(begin(), new_t);
-}
+List<T, Alloc>::List(Alloc alloc) : allocator_(alloc) {}
 
-template <typename T, typename Alloc>
-void List<T, Alloc>::pop_front() {
-  erase(iterator(this, bottom_));
+template <class T, class Alloc>
+List<T, Alloc>::List(size_t size, Alloc alloc) : allocator_(alloc) {
+  link_batch(&sentinel_, size,
+             [this](T* place) { NodeTraits::construct(allocator_, place); });
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-typename List<T, Alloc>::template iterator_common<IsConst>&
-List<T, Alloc>::iterator_common<IsConst>::operator++() {
-  if (!ptr) {
-    return *this;
-  }
-  ptr = ptr->next;
-  return *this;
+template <typename T, typename Alloc>
+List<T, Alloc>::List(size_t size, const T& element, Alloc allocator)
+    : allocator_(allocator) {
+  fill_list(size, element);
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-typename List<T, Alloc>::template iterator_common<IsConst>&
-List<T, Alloc>::iterator_common<IsConst>::operator--() {
-  if (!ptr) {
-    ptr = list_iter->get_top();
-    return *this;
-  }
-  ptr = ptr->prev;
-  return *this;
+template <typename T, typename Alloc>
+template <std::input_iterator InputIt>
+List<T, Alloc>::List(InputIt first, InputIt last, Alloc allocator)
+    : allocator_(allocator) {
+  insert(cend(), first, last);
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-typename List<T, Alloc>::template iterator_common<IsConst>
-List<T, Alloc>::iterator_common<IsConst>::operator++(int) {
-  iterator_common<IsConst> prev_ptr = *this;
-  ++(*this);
-  return prev_ptr;
+template <typename T, typename Alloc>
+List<T, Alloc>::List(std::initializer_list<T> elements, Alloc allocator)
+    : allocator_(allocator) {
+  insert(cend(), elements.begin(), elements.end());
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-typename List<T, Alloc>::template iterator_common<IsConst>
-List<T, Alloc>::iterator_common<IsConst>::operator--(int) {
-  T* prev_ptr = ptr;
-  --(*this);
-  return prev_ptr;
+template <class T, class Alloc>
+inline List<T, Alloc>::List(const List<T, Alloc>& other)
+    : allocator_(std::allocator_traits<NodeAlloc>::
+                     select_on_container_copy_construction(other.allocator_)) {
+  const_iterator it = other.cbegin();
+  link_batch(&sentinel_, other.size_, [this, &it](T* place) {
+    NodeTraits::construct(allocator_, place, *it);
+    ++it;
+  });
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-bool List<T, Alloc>::iterator_common<IsConst>::operator==(
-    const List<T, Alloc>::iterator_common<IsConst>& other) const {
-  return ptr == other.ptr;
+template <class T, class Alloc>
+List<T, Alloc>::List(List<T, Alloc>&& other) noexcept
+    : allocator_(std::move(other.allocator_)) {
+  steal(other);
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-bool List<T, Alloc>::iterator_common<IsConst>::operator!=(
-    const List<T, Alloc>::iterator_common<IsConst>& other) const {
-  return !(*this == other);
+template <typename T, typename Alloc>
+List<T, Alloc>& List<T, Alloc>::operator=(const List<T, Alloc>& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // the copy is built by the allocator this list ends up with and the old
+  // nodes leave together with the allocator that made them
+  constexpr bool kPropagate =
+      NodeTraits::propagate_on_container_copy_assignment::value;
+  List new_list(allocator_);
+  if constexpr (kPropagate) {
+    new_list.allocator_ = other.allocator_;
+  }
+  new_list.insert(new_list.cend(), other.begin(), other.end());
+  if constexpr (kPropagate) {
+    std::swap(allocator_, new_list.allocator_);
+  }
+  swap(new_list);
+  return *this;
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-typename std::conditional<IsConst, const T&, T&>::type
-List<T, Alloc>::iterator_common<IsConst>::operator*() {
-  return ptr->object;
+template <typename T, typename Alloc>
+List<T, Alloc>& List<T, Alloc>::operator=(List<T, Alloc>&& other) noexcept(
+    NodeTraits::propagate_on_container_move_assignment::value ||
+    NodeTraits::is_always_equal::value) {
+  if (this == &other) {
+    return *this;
+  }
+  if constexpr (NodeTraits::propagate_on_container_move_assignment::value) {
+    clear();
+    allocator_ = std::move(other.allocator_);
+    steal(other);
+  } else {
+    if (allocator_ == other.allocator_) {
+      clear();
+      steal(other);
+      return *this;
+    }
+    // foreign nodes cannot be adopted, move the elements one by one
+    List new_list(allocator_);
+    for (T& element : other) {
+      new_list.emplace_back(std::move(element));
+    }
+    swap(new_list);
+  }
+  return *this;
 }
 
-template <class T, typename Alloc>
-template <bool IsConst>
-typename std::conditional<IsConst, const T*, T*>::type
-List<T, Alloc>::iterator_common<IsConst>::operator->() {
-  return &(ptr->object);
+template <typename T, typename Alloc>
+size_t List<T, Alloc>::size() const {
+  return size_;
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-typename List<T, Alloc>::template reverse_iterator_common<Iterator>&
-List<T, Alloc>::reverse_iterator_common<Iterator>::operator++() {
-  --iter_;
-  return *this;
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_back(const T& new_t) {
+  emplace_back(new_t);
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-typename List<T, Alloc>::template reverse_iterator_common<Iterator>&
-List<T, Alloc>::reverse_iterator_common<Iterator>::operator++(int) {
-  Iterator old_iter = iter_;
-  --iter_;
-  return old_iter;
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_back(T&& new_t) {
+  emplace_back(std::move(new_t));
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-typename List<T, Alloc>::template reverse_iterator_common<Iterator>&
-List<T, Alloc>::reverse_iterator_common<Iterator>::operator--() {
-  return ++iter_;
+template <typename T, typename Alloc>
+void List<T, Alloc>::pop_back() {
+  erase(const_iterator(sentinel_.prev));
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-typename List<T, Alloc>::template reverse_iterator_common<Iterator>&
-List<T, Alloc>::reverse_iterator_common<Iterator>::operator--(int) {
-  return iter_++;
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_front(const T& new_t) {
+  emplace_front(new_t);
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-typename Iterator::reference
-List<T, Alloc>::reverse_iterator_common<Iterator>::operator*() {
-  return *iter_;
+template <typename T, typename Alloc>
+void List<T, Alloc>::push_front(T&& new_t) {
+  emplace_front(std::move(new_t));
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-Iterator List<T, Alloc>::reverse_iterator_common<Iterator>::operator->() {
-  return iter_;
+template <typename T, typename Alloc>
+void List<T, Alloc>::pop_front() {
+  erase(const_iterator(sentinel_.next));
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-bool List<T, Alloc>::reverse_iterator_common<Iterator>::operator==(
-    const reverse_iterator_common& other) const {
-  return iter_ == other.iter_;
+template <typename T, typename Alloc>
+template <typename... Args>
+T& List<T, Alloc>::emplace_back(Args&&... args) {
+  Node* node = create_node(std::forward<Args>(args)...);
+  link_before(&sentinel_, node);
+  return node->object;
 }
 
-template <class T, typename Alloc>
-template <class Iterator>
-bool List<T, Alloc>::reverse_iterator_common<Iterator>::operator!=(
-    const reverse_iterator_common& other) const {
-  return !(*this == other);
+template <typename T, typename Alloc>
+template <typename... Args>
+T& List<T, Alloc>::emplace_front(Args&&... args) {
+  Node* node = create_node(std::forward<Args>(args)...);
+  link_before(sentinel_.next, node);
+  return node->object;
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::iterator List<T, Alloc>::begin() {
-  return iterator(this);
+  return iterator(sentinel_.next);
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::iterator List<T, Alloc>::end() {
-  iterator iter(this, nullptr);
-  if (top_ == nullptr) {
-    iter = iterator(this, top_);
-  } else {
-    iter = iterator(this, top_->next);
-  }
-  return iter;
+  return iterator(&sentinel_);
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_iterator List<T, Alloc>::cbegin() const {
-  return const_iterator(this);
+  return const_iterator(sentinel_.next);
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_iterator List<T, Alloc>::cend() const {
-  const_iterator iter(this, top_->next);
-  return iter;
+  return const_iterator(end_hook());
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_iterator List<T, Alloc>::begin() const {
-  return const_iterator(this);
+  return cbegin();
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_iterator List<T, Alloc>::end() const {
-  const_iterator iter(this, top_->next);
-  return iter;
+  return cend();
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::reverse_iterator List<T, Alloc>::rbegin() {
-  iterator iter = end();
-  --iter;
-  return iter;
+  return iterator(sentinel_.prev);
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::reverse_iterator List<T, Alloc>::rend() {
-  iterator iter = begin();
-  --iter;
-  return iter;
+  return iterator(&sentinel_);
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::crbegin()
     const {
-  const_iterator iter = cend();
-  --iter;
-  return iter;
+  return const_iterator(sentinel_.prev);
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::crend() const {
-  const_iterator iter = cbegin();
-  --iter;
-  return iter;
+  return const_iterator(end_hook());
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::rbegin() const {
-  const_iterator iter = cend();
-  --iter;
-  return iter;
+  return crbegin();
 }
 
 template <class T, class Alloc>
 typename List<T, Alloc>::const_reverse_iterator List<T, Alloc>::rend() const {
-  const_iterator iter = cbegin();
-  --iter;
-  return iter;
+  return crend();
 }
 
 template <class T, class Alloc>
-void List<T, Alloc>::insert(List<T, Alloc>::const_iterator it,
-                            const T& element) {
-  Node* new_node;
-  try {
-    new_node = std::allocator_traits<NodeAlloc>::allocate(allocator_, 1);
-  } catch (...) {
-    throw std::bad_alloc();
+template <typename... Args>
+typename List<T, Alloc>::iterator List<T, Alloc>::emplace(
+    List<T, Alloc>::const_iterator it, Args&&... args) {
+  Node* node = create_node(std::forward<Args>(args)...);
+  link_before(it.ptr, node);
+  return iterator(node);
+}
+
+template <class T, class Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(
+    List<T, Alloc>::const_iterator it, const T& element) {
+  return emplace(it, element);
+}
+
+template <class T, class Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(
+    List<T, Alloc>::const_iterator it, T&& element) {
+  return emplace(it, std::move(element));
+}
+
+template <class T, class Alloc>
+template <std::input_iterator InputIt>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(
+    List<T, Alloc>::const_iterator it, InputIt first, InputIt last) {
+  if constexpr (std::forward_iterator<InputIt>) {
+    size_t count = std::distance(first, last);
+    return iterator(link_batch(it.ptr, count, [this, &first](T* place) {
+      NodeTraits::construct(allocator_, place, *first);
+      ++first;
+    }));
+  } else {
+    // single pass ranges have no size, link the copies as one chain anyway
+    List chain(allocator_);
+    for (; first != last; ++first) {
+      chain.emplace_back(*first);
+    }
+    iterator result(chain.size_ == 0 ? it.ptr : chain.sentinel_.next);
+    splice(it, chain);
+    return result;
   }
-  try {
-    std::allocator_traits<NodeAlloc>::construct(allocator_, &(new_node->object),
-                                                element);
-  } catch (...) {
-    std::allocator_traits<NodeAlloc>::deallocate(allocator_, new_node, 1);
-    throw;
+}
+
+template <class T, class Alloc>
+typename List<T, Alloc>::iterator List<T, Alloc>::insert(
+    List<T, Alloc>::const_iterator it, std::initializer_list<T> elements) {
+  return insert(it, elements.begin(), elements.end());
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::erase(List<T, Alloc>::const_iterator it) {
+  unlink(it.ptr);
+  destroy_node(it.ptr);
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::splice(List<T, Alloc>::const_iterator pos,
+                            List<T, Alloc>& other) {
+  if (this == &other || other.size_ == 0) {
+    return;
   }
-  Node* ptr = it.ptr;
-  ++size_;
-  if (ptr != nullptr) {
-    if (it == --end()) {
-      new_node->prev = top_;
-      top_->next = new_node;
-      top_ = new_node;
-      return;
+  if (allocator_ != other.allocator_) {
+    for (T& element : other) {
+      emplace(pos, std::move(element));
     }
-    if (it == begin()) {
-      new_node->next = bottom_;
-      bottom_->prev = new_node;
-      bottom_ = new_node;
-      return;
+    other.clear();
+    return;
+  }
+  size_t count = other.size_;
+  ListHook* first = other.sentinel_.next;
+  ListHook* last = other.sentinel_.prev;
+  other.unlink_range(first, last, count);
+  link_range_before(pos.ptr, first, last, count);
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::splice(List<T, Alloc>::const_iterator pos,
+                            List<T, Alloc>&& other) {
+  splice(pos, other);
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::splice(List<T, Alloc>::const_iterator pos,
+                            List<T, Alloc>& other,
+                            List<T, Alloc>::const_iterator it) {
+  if (this == &other && (it.ptr == pos.ptr || it.ptr->next == pos.ptr)) {
+    return;
+  }
+  if (allocator_ != other.allocator_) {
+    emplace(pos, std::move(value(it.ptr)));
+    other.erase(it);
+    return;
+  }
+  other.unlink(it.ptr);
+  link_before(pos.ptr, it.ptr);
+}
+
+// O(1) within one list or for a whole list, otherwise O(distance) to keep
+// both sizes right
+template <class T, class Alloc>
+void List<T, Alloc>::splice(List<T, Alloc>::const_iterator pos,
+                            List<T, Alloc>& other,
+                            List<T, Alloc>::const_iterator first,
+                            List<T, Alloc>::const_iterator last) {
+  if (first == last) {
+    return;
+  }
+  if (allocator_ != other.allocator_) {
+    while (first != last) {
+      emplace(pos, std::move(value(first.ptr)));
+      other.erase(first++);
     }
-    new_node->next = ptr;
-    if (ptr->prev) {
-      new_node->prev = ptr->prev;
-      ptr->prev->next = new_node;
+    return;
+  }
+  ListHook* last_node = last.ptr->prev;
+  size_t count = 0;
+  if (this != &other) {
+    if (first.ptr == other.sentinel_.next && last.ptr == &other.sentinel_) {
+      count = other.size_;
     } else {
-      top_ = new_node;
+      count = std::distance(first, last);
     }
-  } else {
-    if (bottom_) {
-      bottom_->next = new_node;
-      new_node->prev = bottom_;
-    } else {
-      top_ = new_node;
-      bottom_ = new_node;
+  }
+  other.unlink_range(first.ptr, last_node, count);
+  link_range_before(pos.ptr, first.ptr, last_node, count);
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::merge(List<T, Alloc>& other) {
+  merge(other, std::less<>());
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::merge(List<T, Alloc>&& other) {
+  merge(other, std::less<>());
+}
+
+template <class T, class Alloc>
+template <typename Compare>
+void List<T, Alloc>::merge(List<T, Alloc>& other, Compare comp) {
+  if (this == &other || other.size_ == 0) {
+    return;
+  }
+  if (allocator_ != other.allocator_) {
+    List adopted(allocator_);
+    adopted.splice(adopted.cend(), other);
+    merge(adopted, comp);
+    return;
+  }
+  size_t count = size_ + other.size_;
+  ListHook* first = release_chain();
+  ListHook* second = other.release_chain();
+  adopt_chain(merge_chains(first, second, comp), count);
+}
+
+template <class T, class Alloc>
+void List<T, Alloc>::sort() {
+  sort(std::less<>());
+}
+
+template <class T, class Alloc>
+template <typename Compare>
+void List<T, Alloc>::sort(Compare comp) {
+  if (size_ < 2) {
+    return;
+  }
+  // bins[i] holds a sorted run of 2^i nodes, earlier bins hold later nodes
+  ListHook* bins[64] = {};
+  size_t count = size_;
+  ListHook* ptr = release_chain();
+  while (ptr != nullptr) {
+    ListHook* carry = ptr;
+    ptr = ptr->next;
+    carry->next = nullptr;
+    size_t i = 0;
+    for (; bins[i] != nullptr; ++i) {
+      carry = merge_chains(bins[i], carry, comp);
+      bins[i] = nullptr;
     }
+    bins[i] = carry;
   }
-  if (ptr != nullptr) {
-    ptr->prev = new_node;
+  ListHook* result = nullptr;
+  for (ListHook* bin : bins) {
+    if (bin != nullptr) {
+      result = merge_chains(bin, result, comp);
+    }
   }
+  adopt_chain(result, count);
 }
 
 template <class T, class Alloc>
-void List<T, Alloc>::erase(List<T, Alloc>::const_iterator it) {
-  Node* ptr = it.ptr;
-  if (ptr->prev) {
-    ptr->prev->next = ptr->next;
-    if (ptr->next) {
-      ptr->next->prev = ptr->prev;
+void List<T, Alloc>::reverse() noexcept {
+  ListHook* ptr = &sentinel_;
+  do {
+    std::swap(ptr->prev, ptr->next);
+    ptr = ptr->prev;
+  } while (ptr != &sentinel_);
+}
+
+template <class T, class Alloc>
+size_t List<T, Alloc>::unique() {
+  return unique(std::equal_to<>());
+}
+
+template <class T, class Alloc>
+template <typename BinaryPredicate>
+size_t List<T, Alloc>::unique(BinaryPredicate pred) {
+  size_t removed = 0;
+  if (size_ == 0) {
+    return removed;
+  }
+  ListHook* ptr = sentinel_.next;
+  while (ptr->next != &sentinel_) {
+    if (pred(value(ptr), value(ptr->next))) {
+      erase(const_iterator(ptr->next));
+      ++removed;
     } else {
-      top_ = top_->prev;
+      ptr = ptr->next;
     }
-  } else {
-    if (ptr->next) {
-      bottom_ = ptr->next;
-      ptr->next->prev = nullptr;
-    } else {
-      top_ = nullptr;
-      bottom_ = nullptr;
+  }
+  return removed;
+}
+
+template <class T, class Alloc>
+template <typename Func>
+void List<T, Alloc>::for_each(Func f) {
+  ListHook* ahead = sentinel_.next;
+  for (size_t i = 0; i < kPrefetchDistance && ahead != &sentinel_; ++i) {
+    ahead = ahead->next;
+  }
+  for (ListHook* ptr = sentinel_.next; ptr != &sentinel_; ptr = ptr->next) {
+    if (ahead != &sentinel_) {
+      ahead = ahead->next;
+      __builtin_prefetch(ahead);
+    }
+    f(value(ptr));
+  }
+}
+
+template <class T, class Alloc>
+template <typename Task>
+void List<T, Alloc>::run_split(size_t count, unsigned threads, Task task) {
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (unsigned i = 0; i + 1 < threads; ++i) {
+    workers.emplace_back(task, count * i / threads,
+                         count * (i + 1) / threads);
+  }
+  task(count * (threads - 1) / threads, count);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+template <class T, class Alloc>
+template <typename Func>
+void List<T, Alloc>::parallel_for_each(Func f, unsigned threads) {
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, size_ / kParallelGrain));
+  if constexpr (requires(NodeAlloc alloc) { alloc.stack.stack_storage; }) {
+    const char* arena = allocator_.stack.stack_storage;
+    const char* first = reinterpret_cast<const char*>(sentinel_.next);
+    if (threads > 1 && first >= arena &&
+        size_ * sizeof(Node) <=
+            static_cast<size_t>(arena + allocator_.stack.offset - first)) {
+      // every slot of the range lies inside the arena, check in parallel
+      // that they are linked in order before touching any element
+      Node* nodes = static_cast<Node*>(sentinel_.next);
+      std::atomic<bool> contiguous = true;
+      run_split(size_, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          ListHook* next = (i + 1 == size_) ? &sentinel_ : &nodes[i + 1];
+          if (nodes[i].next != next) {
+            contiguous.store(false, std::memory_order_relaxed);
+            return;
+          }
+        }
+      });
+      if (contiguous.load(std::memory_order_relaxed)) {
+        run_split(size_, threads, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            f(nodes[i].object);
+          }
+        });
+        return;
+      }
     }
   }
-  std::allocator_traits<NodeAlloc>::destroy(allocator_, ptr);
-  std::allocator_traits<NodeAlloc>::deallocate(allocator_, ptr, 1);
-  --size_;
+  for_each(f);
 }
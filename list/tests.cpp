@@ -1,18 +1,32 @@
+#include "compact_list.h"
+#include "concurrent_queue.h"
+#include "deque.h"
+#include "indexed_list.h"
+#include "intrusive_list.h"
 #include "list+stackallocator.h"
+#include "tracing_allocator.h"
+#include "unrolled_list.h"
 
 #include <sys/resource.h>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <deque>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <memory>
+#include <memory_resource>
+#include <random>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
@@ -316,6 +330,66 @@ void TestAlignment() {
   ldalloc.deallocate(pld, 25);
 }
 
+void TestLargeArena() {
+  // The offset must survive crossing 2^31, untouched pages are never committed
+  constexpr size_t kLargeSize = 2'200'000'000;
+  auto storage = std::make_unique<StackStorage<kLargeSize>>();
+  assert(reinterpret_cast<uintptr_t>(storage->stack_storage) % kHugePageSize ==
+         0);
+
+  StackAllocator<char, kLargeSize> charalloc(*storage);
+  charalloc.allocate(2'150'000'000);
+  StackAllocator<int, kLargeSize> intalloc(charalloc);
+  int* pint = intalloc.allocate(4);
+  pint[3] = 42;
+  assert(storage->offset == 2'150'000'016);
+
+  bool thrown = false;
+  try {
+    intalloc.allocate(20'000'000);
+  } catch (const std::bad_alloc&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+template <typename Alloc>
+double DenseNodeAllocation(Alloc alloc, size_t count) {
+  using namespace std::chrono;
+  using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<
+      std::array<void*, 3>>;
+  NodeAlloc node_alloc(alloc);
+  std::vector<std::array<void*, 3>*> nodes(count);
+
+  auto start = high_resolution_clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    nodes[i] = std::allocator_traits<NodeAlloc>::allocate(node_alloc, 1);
+    (*nodes[i])[0] = nodes[i];
+  }
+  auto finish = high_resolution_clock::now();
+
+  for (size_t i = 0; i < count; ++i) {
+    std::allocator_traits<NodeAlloc>::deallocate(node_alloc, nodes[i], 1);
+  }
+  return static_cast<double>(
+             duration_cast<nanoseconds>(finish - start).count()) /
+         count;
+}
+
+void TestDenseNodeAllocation() {
+  constexpr size_t kNodes = 5'000'000;
+  auto storage = std::make_unique<StackStorage<STORAGE_SIZE>>();
+  StackAllocator<int, STORAGE_SIZE> alloc(*storage);
+
+  double stack_ns = DenseNodeAllocation(alloc, kNodes);
+  // 24-byte nodes are already aligned, so not a single byte of padding
+  assert(storage->offset == kNodes * sizeof(std::array<void*, 3>));
+  double heap_ns = DenseNodeAllocation(std::allocator<int>(), kNodes);
+
+  std::cerr << " Dense node allocation: StackAllocator " << stack_ns
+            << " ns/op, std::allocator " << heap_ns << " ns/op" << std::endl;
+}
+
 template <typename T, bool PropagateOnConstruct, bool PropagateOnAssign>
 struct WhimsicalAllocator : public std::allocator<T> {
   std::shared_ptr<int> number;
@@ -409,6 +483,328 @@ void TestWhimsicalAllocator() {
   }
 }
 
+// Remembers the blocks handed out through its copies and fails the test when
+// a block is released through an allocator that did not allocate it
+template <typename T, bool PropagateOnAssign>
+struct OwningAllocator {
+  using value_type = T;
+  using propagate_on_container_copy_assignment =
+      std::bool_constant<PropagateOnAssign>;
+
+  std::shared_ptr<std::set<void*>> blocks =
+      std::make_shared<std::set<void*>>();
+
+  OwningAllocator() = default;
+  template <typename U>
+  OwningAllocator(const OwningAllocator<U, PropagateOnAssign>& other)
+      : blocks(other.blocks) {}
+  template <typename U>
+  struct rebind {
+    using other = OwningAllocator<U, PropagateOnAssign>;
+  };
+
+  T* allocate(size_t count) {
+    T* ptr = std::allocator<T>().allocate(count);
+    blocks->insert(ptr);
+    return ptr;
+  }
+  void deallocate(T* ptr, size_t count) {
+    size_t erased = blocks->erase(ptr);
+    assert(erased == 1);
+    std::allocator<T>().deallocate(ptr, count);
+  }
+  template <typename U>
+  bool operator==(const OwningAllocator<U, PropagateOnAssign>& other) const {
+    return blocks == other.blocks;
+  }
+};
+
+template <typename Container, typename Alloc>
+void TestCopyAssignAllocator() {
+  Alloc first_alloc;
+  Alloc second_alloc;
+  {
+    Container first(first_alloc);
+    Container second(second_alloc);
+    for (int i = 0; i < 10; ++i) {
+      first.push_back(i);
+      second.push_back(-i);
+      second.push_back(i);
+    }
+    first = second;
+    assert(first.size() == 20 && *first.begin() == 0);
+    first.push_back(20);
+    second = first;
+    assert(second.size() == 21);
+  }
+  assert(first_alloc.blocks->empty() && second_alloc.blocks->empty());
+}
+
+void TestChunkedStorage() {
+  ChunkedStackStorage storage(1 << 12);
+  {
+    List<int, ChunkedStackAllocator<int>> lst(storage);
+    for (int i = 0; i < 10'000; ++i) {
+      lst.push_back(i);
+    }
+    assert(lst.size() == 10'000);
+    assert(*lst.rbegin() == 9'999);
+  }
+  assert(storage.chunks_count() > 1);
+
+  const int kThreads = 4;
+  const int kPerThread = 50'000;
+  std::vector<std::vector<long long*>> pointers(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&storage, &pointers, t] {
+      ChunkedStackAllocator<long long> alloc(storage);
+      for (int i = 0; i < kPerThread; ++i) {
+        long long* ptr = alloc.allocate(1);
+        assert(reinterpret_cast<uintptr_t>(ptr) % alignof(long long) == 0);
+        *ptr = static_cast<long long>(t) * kPerThread + i;
+        pointers[t].push_back(ptr);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < kThreads; ++t) {
+    for (int i = 0; i < kPerThread; ++i) {
+      assert(*pointers[t][i] == static_cast<long long>(t) * kPerThread + i);
+    }
+  }
+
+  size_t chunks = storage.chunks_count();
+  storage.reset();
+  ChunkedStackAllocator<char> charalloc(storage);
+  charalloc.allocate(100);
+  assert(storage.chunks_count() == chunks);
+
+  ChunkedStackAllocator<long long> longalloc(storage);
+  bool thrown = false;
+  try {
+    longalloc.allocate(SIZE_MAX / 4);
+  } catch (const std::bad_array_new_length&) {
+    thrown = true;
+  }
+  assert(thrown && storage.chunks_count() == chunks);
+
+  // fits size_t but not a chunk with its header and alignment slack
+  thrown = false;
+  try {
+    longalloc.allocate(SIZE_MAX / sizeof(long long) - 1);
+  } catch (const std::bad_alloc&) {
+    thrown = true;
+  }
+  assert(thrown && storage.chunks_count() == chunks);
+}
+
+void TestArenaScopes() {
+  StackStorage<200'000> storage;
+  StackAllocator<int, 200'000> alloc(storage);
+  List<int, StackAllocator<int, 200'000>> kept(10, 1, alloc);
+  size_t offset = storage.offset;
+  {
+    ArenaScope outer(storage);
+    List<int, StackAllocator<int, 200'000>> first(1'000, 2, alloc);
+    size_t inner_offset = 0;
+    {
+      ArenaScope inner(storage);
+      inner_offset = storage.offset;
+      List<int, StackAllocator<int, 200'000>> second(1'000, 3, alloc);
+      assert(storage.offset > inner_offset);
+    }
+    assert(storage.offset == inner_offset);
+    assert(first.size() == 1'000 && *first.rbegin() == 2);
+  }
+  assert(storage.offset == offset);
+  assert(kept.size() == 10 && *kept.begin() == 1);
+
+  // rewound chunks are reused instead of growing the chain
+  ChunkedStackStorage chunked(1 << 12);
+  ChunkedStackAllocator<int> chunked_alloc(chunked);
+  size_t chunks = 0;
+  for (int round = 0; round < 3; ++round) {
+    ArenaScope scope(chunked);
+    List<int, ChunkedStackAllocator<int>> lst(chunked_alloc);
+    for (int i = 0; i < 2'000; ++i) {
+      lst.push_back(i);
+    }
+    assert(*lst.rbegin() == 1'999);
+    if (round == 0) {
+      chunks = chunked.chunks_count();
+      assert(chunks > 1);
+    }
+    assert(chunked.chunks_count() == chunks);
+  }
+}
+
+void TestArenaResource() {
+  using PmrList = List<int, std::pmr::polymorphic_allocator<int>>;
+  ArenaResource small(1'000);
+  ArenaResource large(1'000'000);
+  // one container type for both capacities
+  PmrList first(&small);
+  PmrList second(&large);
+  for (int i = 0; i < 1'000; ++i) {
+    first.push_back(i);
+    second.push_back(i);
+  }
+  assert(small.used() <= small.capacity() && small.upstream_allocations() > 0);
+  assert(large.upstream_allocations() == 0 && large.used() >= 1'000 * 20);
+  assert(*first.rbegin() == 999 && *second.rbegin() == 999);
+  first.clear();
+
+  alignas(kCacheLineSize) char buffer[4'096];
+  ArenaResource on_stack(buffer, sizeof(buffer));
+  {
+    std::pmr::vector<std::pmr::string> strings(&on_stack);
+    strings.emplace_back("a string long enough to leave the small buffer");
+    strings.emplace_back(10, 'x');
+    assert(strings[0].get_allocator().resource() == &on_stack);
+  }
+  auto mark = on_stack.checkpoint();
+  std::pmr::vector<long long> numbers(100, 7, &on_stack);
+  assert(on_stack.used() >= mark + 100 * sizeof(long long));
+  numbers.clear();
+  numbers.shrink_to_fit();
+  on_stack.rewind(mark);
+  assert(on_stack.used() == mark && on_stack.upstream_allocations() == 0);
+}
+
+void TestTracingAllocator() {
+  using TracedList = List<int, TracingAllocator<std::allocator<int>>>;
+  AllocationTracer::reset();
+  {
+    TracedList untraced(10, 1);
+    assert(untraced.size() == 10);
+  }
+  assert(AllocationTracer::snapshot().allocations == 0);
+
+  AllocationTracer::enable();
+  {
+    TraceTag tag("list");
+    TracedList lst;
+    for (int i = 0; i < 100; ++i) {
+      lst.push_back(i);
+    }
+    TracedList copy = lst;
+    AllocationTracer::Snapshot snap = AllocationTracer::snapshot();
+    assert(snap.allocations == 200 && snap.deallocations == 0);
+    assert(snap.live_bytes == snap.peak_live_bytes);
+    assert(snap.allocated_bytes == snap.live_bytes);
+    assert(snap.live_bytes % 200 == 0);
+  }
+  {
+    TraceTag tag("vector");
+    std::vector<long long, TracingAllocator<std::allocator<long long>>> vec;
+    for (int i = 0; i < 1'000; ++i) {
+      vec.push_back(i);
+    }
+  }
+  AllocationTracer::Snapshot snap = AllocationTracer::snapshot();
+  AllocationTracer::enable(false);
+  assert(snap.allocations == snap.deallocations && snap.live_bytes == 0);
+  assert(snap.sites.at("list").allocations == 200);
+  assert(snap.sites.at("vector").bytes >= 1'000 * sizeof(long long));
+  unsigned long long lifetimes = 0;
+  for (unsigned long long count : snap.lifetimes) {
+    lifetimes += count;
+  }
+  assert(lifetimes == snap.deallocations);
+  std::ostringstream out;
+  out << snap;
+  assert(out.str().find("alloc.site.vector.bytes") != std::string::npos);
+  AllocationTracer::Snapshot open_bucket;
+  open_bucket.sizes[AllocationTracer::kHistogramBuckets - 1] = 1;
+  out.str("");
+  out << open_bucket;
+  assert(out.str().find("alloc.size_bytes_ge_70368744177664 1") !=
+         std::string::npos);
+  // nothing left to dump at exit
+  AllocationTracer::reset();
+
+  // a traced arena is seen one block at a time
+  static_assert(
+      !is_bump_allocator_v<TracingAllocator<StackAllocator<int, 100'000>>>);
+  using TracedArena = TracingAllocator<StackAllocator<int, 100'000>>;
+  StackStorage<100'000> storage;
+  AllocationTracer::enable();
+  {
+    List<int, TracedArena> arena_list{TracedArena(storage)};
+    for (int i = 0; i < 50; ++i) {
+      arena_list.push_back(i);
+    }
+    arena_list.clear();
+    arena_list.push_back(1);
+  }
+  snap = AllocationTracer::snapshot();
+  AllocationTracer::enable(false);
+  assert(snap.allocations == 51 && snap.deallocations == 51);
+  assert(snap.live_bytes == 0);
+  AllocationTracer::reset();
+}
+
+void TestPoolAllocator() {
+  PoolStorage storage;
+  PoolAllocator<long long> alloc(storage);
+
+  long long* first = alloc.allocate(1);
+  alloc.deallocate(first, 1);
+  assert(alloc.allocate(1) == first);
+
+  PoolAllocator<long double> ldalloc(alloc);
+  assert(ldalloc == alloc);
+  auto* pld = ldalloc.allocate(3);
+  assert(reinterpret_cast<uintptr_t>(pld) % alignof(long double) == 0);
+  ldalloc.deallocate(pld, 3);
+
+  auto* big = alloc.allocate(1'000);
+  alloc.deallocate(big, 1'000);
+
+  bool thrown = false;
+  try {
+    alloc.allocate(SIZE_MAX / 4);
+  } catch (const std::bad_array_new_length&) {
+    thrown = true;
+  }
+  assert(thrown && !PoolStorage::is_small(SIZE_MAX, 1));
+
+  {
+    List<int, PoolAllocator<int>> lst(alloc);
+    for (int round = 0; round < 100; ++round) {
+      for (int i = 0; i < 10'000; ++i) {
+        lst.push_back(i);
+      }
+      for (int i = 0; i < 10'000; ++i) {
+        lst.pop_front();
+      }
+    }
+    assert(lst.size() == 0);
+  }
+  // 10'000 nodes fit in a handful of chunks when blocks are recycled
+  assert(storage.chunks_count() <= 10);
+
+  TestAccountant<PoolAllocator<Accountant>>(alloc);
+
+  // a copy assigned across pools lives in the pool of its destination
+  auto source_storage = std::make_unique<PoolStorage>();
+  List<int, PoolAllocator<int>> target(10, 1, alloc);
+  {
+    List<int, PoolAllocator<int>> source(20, 2, *source_storage);
+    target = source;
+  }
+  source_storage.reset();
+  target.push_back(3);
+  assert(target.size() == 21 && *target.rbegin() == 3);
+  TestCopyAssignAllocator<List<int, OwningAllocator<int, false>>,
+                          OwningAllocator<int, false>>();
+  TestCopyAssignAllocator<List<int, OwningAllocator<int, true>>,
+                          OwningAllocator<int, true>>();
+}
+
 template <class List>
 int ListPerformanceTest(List&& l) {
   using namespace std::chrono;
@@ -465,6 +861,937 @@ int ListPerformanceTest(List&& l) {
   return duration_cast<milliseconds>(finish - start).count();
 }
 
+struct CopyCounter {
+  static size_t copies;
+  std::vector<int> payload;
+
+  CopyCounter(int size) : payload(size) {}
+  CopyCounter(const CopyCounter& other) : payload(other.payload) { ++copies; }
+  CopyCounter(CopyCounter&&) = default;
+  CopyCounter& operator=(const CopyCounter& other) {
+    payload = other.payload;
+    ++copies;
+    return *this;
+  }
+  CopyCounter& operator=(CopyCounter&&) = default;
+};
+
+size_t CopyCounter::copies = 0;
+
+void TestMoveSemantics() {
+  CopyCounter::copies = 0;
+  {
+    List<CopyCounter> lst;
+    lst.push_back(CopyCounter(100));
+    lst.push_front(CopyCounter(200));
+    lst.emplace_back(300);
+    lst.emplace_front(400);
+    CopyCounter big(500);
+    auto it = lst.insert(++lst.cbegin(), std::move(big));
+    assert(it->payload.size() == 500);
+    it = lst.emplace(lst.cend(), 600);
+    assert(it->payload.size() == 600);
+    assert(CopyCounter::copies == 0);
+
+    std::string sizes;
+    for (const auto& x : lst) {
+      sizes += std::to_string(x.payload.size()) + ",";
+    }
+    assert(sizes == "400,500,200,100,300,600,");
+
+    List<CopyCounter> moved(std::move(lst));
+    assert(moved.size() == 6);
+    assert(lst.size() == 0);
+    lst = std::move(moved);
+    assert(lst.size() == 6);
+    assert(moved.size() == 0);
+    assert(CopyCounter::copies == 0);
+    moved.emplace_back(1);
+    assert(moved.size() == 1);
+  }
+
+  List<std::unique_ptr<int>> unique;
+  unique.push_back(std::make_unique<int>(5));
+  assert(**unique.begin() == 5);
+  assert(unique.emplace_back(new int(6)) != nullptr);
+
+  List<std::string> strings;
+  std::string& ref = strings.emplace_back(10, 'x');
+  assert(ref == "xxxxxxxxxx");
+
+  {
+    // different storages never compare equal, so nodes cannot be adopted
+    StackStorage<200'000> first_storage;
+    StackStorage<200'000> second_storage;
+    StackAllocator<std::string, 200'000> first_alloc(first_storage);
+    StackAllocator<std::string, 200'000> second_alloc(second_storage);
+    List<std::string, StackAllocator<std::string, 200'000>> first(first_alloc);
+    List<std::string, StackAllocator<std::string, 200'000>> second(
+        second_alloc);
+    first.push_back("move me");
+    first.push_back("and me");
+    second = std::move(first);
+    assert(second.size() == 2);
+    assert(*second.begin() == "move me");
+    assert(second.get_allocator() == second_alloc);
+    size_t offset = second_storage.offset;
+    second.push_back("third");
+    assert(second_storage.offset > offset);
+  }
+}
+
+template <typename Alloc = std::allocator<int>>
+void TestRelinking(Alloc alloc = Alloc()) {
+  auto to_string = [](const auto& lst) {
+    std::string s;
+    for (int x : lst) {
+      s += std::to_string(x);
+    }
+    return s;
+  };
+
+  List<int, Alloc> first(alloc);
+  List<int, Alloc> second(alloc);
+  for (int i = 0; i < 5; ++i) {
+    first.push_back(i);
+    second.push_back(i + 5);
+  }
+
+  auto it = second.cbegin();
+  first.splice(std::next(first.cbegin()), second);
+  assert(to_string(first) == "0567891234");
+  assert(second.size() == 0 && first.size() == 10);
+  assert(*it == 5);
+
+  second.splice(second.end(), first, it);
+  assert(to_string(second) == "5");
+  first.splice(first.cbegin(), first, std::prev(first.cend(), 3),
+               first.cend());
+  assert(to_string(first) == "234067891");
+  second.splice(second.cbegin(), first, first.cbegin(),
+                std::next(first.cbegin(), 4));
+  assert(to_string(second) == "23405" && second.size() == 5);
+  assert(to_string(first) == "67891" && first.size() == 5);
+
+  first.reverse();
+  assert(to_string(first) == "19876");
+  assert(*first.rbegin() == 6);
+  first.sort();
+  second.sort();
+  assert(to_string(first) == "16789");
+  assert(to_string(second) == "02345");
+  first.merge(second);
+  assert(to_string(first) == "0123456789" && first.size() == 10);
+  assert(second.size() == 0);
+
+  first.sort(std::greater<>());
+  assert(to_string(first) == "9876543210");
+  assert(*std::prev(first.end()) == 0);
+
+  for (int x : {1, 1, 2, 2, 2, 3, 1}) {
+    second.push_back(x);
+  }
+  assert(second.unique() == 3);
+  assert(to_string(second) == "1231");
+
+  // stability: equal keys keep their relative order
+  List<std::pair<int, int>> pairs;
+  for (int i = 0; i < 1'000; ++i) {
+    pairs.emplace_back(i % 7, i);
+  }
+  pairs.sort([](const auto& a, const auto& b) { return a.first < b.first; });
+  assert(std::is_sorted(pairs.begin(), pairs.end()));
+}
+
+void TestSentinel() {
+  const List<int> empty;
+  assert(empty.cbegin() == empty.cend());
+  assert(empty.begin() == empty.end());
+  assert(empty.crbegin() == empty.crend());
+
+  List<int> lst;
+  auto end = lst.end();
+  lst.push_back(1);
+  lst.push_front(0);
+  assert(end == lst.end());
+  assert(*std::prev(end) == 1);
+  assert(*std::next(end) == 0);
+  lst.pop_back();
+  lst.pop_back();
+  assert(lst.begin() == end);
+
+  List<int> moved(std::move(lst));
+  moved.push_back(5);
+  assert(*moved.begin() == 5 && lst.begin() == lst.end());
+  lst = moved;
+  std::swap(lst, moved);
+  assert(*lst.rbegin() == 5 && *moved.rbegin() == 5);
+}
+
+void TestBulkConstruction() {
+  StackStorage<100'000> storage;
+  StackAllocator<int, 100'000> alloc(storage);
+
+  // one slab per batch: consecutive nodes sit at a constant stride
+  List<int, StackAllocator<int, 100'000>> lst(100, 7, alloc);
+  std::vector<const int*> addresses;
+  for (const int& x : lst) {
+    addresses.push_back(&x);
+  }
+  for (size_t i = 2; i < addresses.size(); ++i) {
+    assert(addresses[i] - addresses[i - 1] == addresses[1] - addresses[0]);
+  }
+  auto copy = lst;
+  assert(copy.size() == 100 && *copy.begin() == 7);
+
+  // batching follows the allocator's nested is_bump_allocator tag
+  static_assert(is_bump_allocator_v<StackAllocator<int, 100'000>>);
+  static_assert(is_bump_allocator_v<ChunkedStackAllocator<int>>);
+  static_assert(!is_bump_allocator_v<PoolAllocator<int>>);
+  static_assert(!is_bump_allocator_v<std::allocator<int>>);
+
+  List<int> from_init{1, 2, 3, 4};
+  std::vector<int> v{10, 20, 30};
+  List<int> from_range(v.begin(), v.end());
+  auto it = from_init.insert(std::next(from_init.cbegin(), 2), v.begin(),
+                             v.end());
+  assert(*it == 10);
+  std::istringstream in("5 6");
+  it = from_init.insert(from_init.cend(), std::istream_iterator<int>(in),
+                        std::istream_iterator<int>());
+  assert(*it == 5);
+  it = from_init.insert(from_init.cbegin(), {0});
+  assert(it == from_init.begin());
+  assert(from_init.insert(from_init.cend(), v.end(), v.end()) ==
+         from_init.end());
+  std::string s;
+  for (int x : from_init) {
+    s += std::to_string(x) + ",";
+  }
+  assert(s == "0,1,2,10,20,30,3,4,5,6,");
+  assert(from_range.size() == 3 && *from_range.rbegin() == 30);
+
+  // a throwing element leaves the list untouched
+  ThrowingAccountant::need_throw = false;
+  List<ThrowingAccountant> accounts(3);
+  std::vector<ThrowingAccountant> source(10);
+  Accountant::reset();
+  ThrowingAccountant::need_throw = true;
+  try {
+    accounts.insert(accounts.cbegin(), source.begin(), source.end());
+    assert(false);
+  } catch (...) {
+    assert(Accountant::ctor_calls == 4 && Accountant::dtor_calls == 4);
+  }
+  ThrowingAccountant::need_throw = false;
+  assert(accounts.size() == 3);
+}
+
+struct Session {
+  int id = 0;
+  ListHook by_age;
+  std::string name;
+  ListHook by_activity;
+};
+
+void TestIntrusiveList() {
+  std::vector<Session> sessions(6);
+  IntrusiveList<Session, &Session::by_age> by_age;
+  IntrusiveList<Session, &Session::by_activity> by_activity;
+  for (int i = 0; i < 6; ++i) {
+    sessions[i].id = i;
+    by_age.push_back(sessions[i]);
+    by_activity.push_front(sessions[i]);
+  }
+  assert(by_age.size() == 6 && by_age.front().id == 0);
+  assert(by_activity.front().id == 5 && by_activity.back().id == 0);
+
+  // unlinking from one list leaves the other one alone
+  by_age.unlink(sessions[3]);
+  assert(!decltype(by_age)::is_linked(sessions[3]));
+  assert(decltype(by_activity)::is_linked(sessions[3]));
+  auto it = by_age.erase(decltype(by_age)::iterator_to(sessions[1]));
+  assert(it->id == 2);
+  it = by_age.insert(it, sessions[3]);
+  std::string s;
+  for (const Session& session : by_age) {
+    s += std::to_string(session.id) + ",";
+  }
+  assert(s == "0,3,2,4,5,");
+  s.clear();
+  for (auto rit = by_age.crbegin(); rit != by_age.crend(); ++rit) {
+    s += std::to_string(rit->id) + ",";
+  }
+  assert(s == "5,4,2,3,0,");
+
+  IntrusiveList<Session, &Session::by_age> moved(std::move(by_age));
+  assert(by_age.empty() && moved.size() == 5 && moved.back().id == 5);
+  by_age.push_back(sessions[1]);
+  by_age.splice(by_age.cbegin(), moved);
+  assert(moved.empty() && by_age.size() == 6 && by_age.back().id == 1);
+  by_age.pop_front();
+  assert(!decltype(by_age)::is_linked(sessions[0]));
+  by_age.clear();
+  assert(!decltype(by_age)::is_linked(sessions[5]));
+}
+
+template <typename Alloc = std::allocator<long long>>
+void TestConcurrentQueue(Alloc alloc = Alloc()) {
+  ConcurrentQueue<long long, Alloc> queue(alloc);
+  long long value = 0;
+  assert(queue.empty() && !queue.try_pop(value));
+  queue.push(1);
+  queue.emplace(2);
+  assert(!queue.empty());
+  assert(queue.try_pop(value) && value == 1);
+  assert(queue.try_pop(value) && value == 2);
+  assert(!queue.try_pop(value));
+
+  const int kProducers = 4;
+  const int kConsumers = 4;
+  const long long kPerProducer = 20'000;
+  std::atomic<long long> popped = 0;
+  std::vector<std::vector<long long>> seen(kConsumers);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kProducers; ++t) {
+    threads.emplace_back([&queue, t] {
+      for (long long i = 0; i < kPerProducer; ++i) {
+        queue.push(t * kPerProducer + i);
+      }
+    });
+  }
+  for (int t = 0; t < kConsumers; ++t) {
+    threads.emplace_back([&queue, &popped, &seen, t] {
+      long long value = 0;
+      while (popped.load() < kProducers * kPerProducer) {
+        if (queue.try_pop(value)) {
+          seen[t].push_back(value);
+          ++popped;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // every value exactly once, and each consumer sees a producer's values in
+  // the order they were pushed
+  std::vector<long long> all;
+  for (auto& values : seen) {
+    std::vector<long long> last(kProducers, -1);
+    for (long long x : values) {
+      assert(x > last[x / kPerProducer]);
+      last[x / kPerProducer] = x;
+    }
+    all.insert(all.end(), values.begin(), values.end());
+  }
+  std::sort(all.begin(), all.end());
+  assert(static_cast<long long>(all.size()) == kProducers * kPerProducer);
+  for (size_t i = 0; i < all.size(); ++i) {
+    assert(all[i] == static_cast<long long>(i));
+  }
+
+  // elements left in the queue are destroyed with it
+  ConcurrentQueue<std::string, Alloc> strings(alloc);
+  strings.push(std::string(100, 'a'));
+  strings.push("b");
+}
+
+// Half of the threads push, half pop, through a ConcurrentQueue and through
+// a List behind a mutex
+template <class Queue, class Push, class Pop>
+long long QueueContentionTest(Queue& queue, Push push, Pop pop, int threads,
+                              long long operations) {
+  using namespace std::chrono;
+  int producers = std::max(threads / 2, 1);
+  int consumers = std::max(threads - producers, 1);
+  long long per_producer = operations / producers;
+  std::atomic<long long> popped = 0;
+  std::vector<std::thread> workers;
+  auto start = high_resolution_clock::now();
+  for (int t = 0; t < producers; ++t) {
+    workers.emplace_back([&, t] {
+      for (long long i = 0; i < per_producer; ++i) {
+        push(queue, i);
+      }
+      if (threads == 1) {
+        while (popped.load() < per_producer) {
+          popped += pop(queue);
+        }
+      }
+    });
+  }
+  for (int t = 0; t < consumers && threads > 1; ++t) {
+    workers.emplace_back([&] {
+      while (popped.load() < per_producer * producers) {
+        popped += pop(queue);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto finish = high_resolution_clock::now();
+  return duration_cast<nanoseconds>(finish - start).count() /
+         (2 * per_producer * producers);
+}
+
+void TestQueueContention() {
+  const long long kOperations = 200'000;
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    ConcurrentQueue<long long> lock_free;
+    long long lock_free_ns = QueueContentionTest(
+        lock_free,
+        [](ConcurrentQueue<long long>& q, long long x) { q.push(x); },
+        [](ConcurrentQueue<long long>& q) {
+          long long x = 0;
+          return q.try_pop(x) ? 1 : 0;
+        },
+        threads, kOperations);
+
+    std::pair<std::mutex, List<long long>> locked;
+    long long locked_ns = QueueContentionTest(
+        locked,
+        [](auto& q, long long x) {
+          std::lock_guard lock(q.first);
+          q.second.push_back(x);
+        },
+        [](auto& q) {
+          std::lock_guard lock(q.first);
+          if (q.second.size() == 0) {
+            return 0;
+          }
+          q.second.pop_front();
+          return 1;
+        },
+        threads, kOperations);
+    std::cerr << " " << threads << " threads: ConcurrentQueue " << lock_free_ns
+              << " ns/op, mutex + List " << locked_ns << " ns/op" << std::endl;
+  }
+}
+
+void TestThreadArenas() {
+  using Alloc = ThreadLocalAllocator<int>;
+  List<int, Alloc> handed_over;
+  size_t chunks = 0;
+  std::thread builder([&handed_over, &chunks] {
+    List<int, Alloc> lst;
+    for (int i = 0; i < 5'000; ++i) {
+      lst.push_back(i);
+    }
+    chunks = ThreadArenaRegistry::local().chunks_count();
+    handed_over = std::move(lst);
+  });
+  builder.join();
+
+  // freed remotely into the idle arena of the finished thread, which the
+  // next thread adopts and allocates from again without growing it
+  handed_over.clear();
+  std::thread reuser([chunks] {
+    List<int, Alloc> lst(5'000, 1);
+    assert(ThreadArenaRegistry::local().chunks_count() == chunks);
+  });
+  reuser.join();
+
+  // a producer keeps building lists that a consumer destroys concurrently
+  const int kRounds = 200;
+  std::atomic<int> built = 0;
+  std::atomic<int> destroyed = 0;
+  std::vector<List<int, Alloc>> slots(kRounds);
+  std::thread producer([&] {
+    for (int i = 0; i < kRounds; ++i) {
+      while (destroyed.load() + 2 <= i) {
+        std::this_thread::yield();
+      }
+      slots[i] = List<int, Alloc>(1'000, i);
+      built.store(i + 1);
+    }
+    assert(ThreadArenaRegistry::local().chunks_count() <= chunks + 2);
+  });
+  std::thread consumer([&] {
+    for (int i = 0; i < kRounds; ++i) {
+      while (built.load() <= i) {
+        std::this_thread::yield();
+      }
+      assert(*slots[i].begin() == i && slots[i].size() == 1'000);
+      slots[i].clear();
+      destroyed.store(i + 1);
+    }
+  });
+  producer.join();
+  consumer.join();
+  assert(ThreadArenaRegistry::arenas_count() <= 3);
+
+  bool thrown = false;
+  try {
+    ThreadLocalAllocator<long long>().allocate(SIZE_MAX / 4);
+  } catch (const std::bad_array_new_length&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+template <typename Alloc = std::allocator<int>>
+void TestRingDeque(Alloc alloc = Alloc()) {
+  Deque<int, Alloc> deque(alloc);
+  for (int i = 0; i < 5; ++i) {
+    deque.push_back(i);
+    deque.push_front(-i - 1);
+  }
+  assert(deque.size() == 10 && deque.front() == -5 && deque.back() == 4);
+  for (int i = 0; i < 10; ++i) {
+    assert(deque[i] == i - 5);
+  }
+  // wrapped around and grown past the first ring
+  for (int i = 0; i < 100; ++i) {
+    deque.push_front(-6 - i);
+  }
+  assert(deque.front() == -105 && deque[105] == 0 && deque.back() == 4);
+  assert(deque.end() - deque.begin() == 110);
+  assert(*(deque.begin() + 105) == 0 && deque.rbegin()[1] == 3);
+  assert(std::is_sorted(deque.begin(), deque.end()));
+  bool thrown = false;
+  try {
+    deque.at(110);
+  } catch (std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  auto copy = deque;
+  deque.pop_front();
+  deque.pop_back();
+  assert(deque.front() == -104 && deque.back() == 3 && copy.size() == 110);
+  deque = std::move(copy);
+  assert(deque.size() == 110 && deque.at(109) == 4);
+  deque.clear();
+  assert(deque.empty());
+
+  // an element of a full ring may be the source of the push that grows it
+  while (deque.size() < deque.capacity()) {
+    deque.push_back(static_cast<int>(deque.size()) + 1);
+  }
+  deque.push_back(deque.front());
+  assert(deque.back() == 1 && deque.front() == 1);
+  while (deque.size() < deque.capacity()) {
+    deque.push_front(0);
+  }
+  deque.push_front(deque.back());
+  assert(deque.front() == 1 && deque.back() == 1);
+}
+
+template <class Queue>
+int FifoPerformanceTest(Queue&& queue, int window, int operations) {
+  using namespace std::chrono;
+  for (int i = 0; i < window; ++i) {
+    queue.push_back(i);
+  }
+  auto start = high_resolution_clock::now();
+  long long sum = 0;
+  for (int i = 0; i < operations; ++i) {
+    sum += *queue.begin();
+    queue.pop_front();
+    queue.push_back(i);
+  }
+  auto finish = high_resolution_clock::now();
+  assert(sum >= 0);
+  return duration_cast<milliseconds>(finish - start).count();
+}
+
+void TestDequeGrowth() {
+  // the ring stays on top of the arena, so doubling extends it in place
+  StackStorage<200'000> storage;
+  StackAllocator<int, 200'000> alloc(storage);
+  TestRingDeque<StackAllocator<int, 200'000>>(alloc);
+
+  size_t offset = storage.offset;
+  Deque<int, StackAllocator<int, 200'000>> deque(alloc);
+  for (int i = 0; i < 3; ++i) {
+    deque.push_front(-i - 1);
+  }
+  for (int i = 0; i < 4'000; ++i) {
+    deque.push_back(i);
+  }
+  assert(deque.capacity() == 4'096);
+  assert(storage.offset - offset <= 4'096 * sizeof(int) + kCacheLineSize);
+  for (int i = 0; i < 4'003; ++i) {
+    assert(deque[i] == i - 3);
+  }
+
+  Deque<std::string> names;
+  while (names.size() < 8) {
+    names.push_back("name " + std::to_string(names.size()));
+  }
+  names.push_back(names.front());
+  names.emplace_front(names.back());
+  assert(names.front() == "name 0" && names[1] == "name 0");
+  assert(names.back() == "name 0" && names.size() == 10);
+
+  // a throwing copy leaves nothing behind
+  ThrowingAccountant::need_throw = false;
+  ThrowingAccountant source;
+  Accountant::reset();
+  ThrowingAccountant::need_throw = true;
+  bool thrown = false;
+  try {
+    Deque<ThrowingAccountant> accounts(10, source);
+  } catch (...) {
+    thrown = true;
+  }
+  ThrowingAccountant::need_throw = false;
+  assert(thrown && Accountant::ctor_calls == Accountant::dtor_calls);
+
+  // moving between unequal arenas copies elements and may run out of space
+  static_assert(std::is_nothrow_move_assignable_v<Deque<int>>);
+  static_assert(!std::is_nothrow_move_assignable_v<
+                Deque<int, StackAllocator<int, 200'000>>>);
+  TestCopyAssignAllocator<Deque<int, OwningAllocator<int, false>>,
+                          OwningAllocator<int, false>>();
+  TestCopyAssignAllocator<Deque<int, OwningAllocator<int, true>>,
+                          OwningAllocator<int, true>>();
+
+  const int kWindow = 1'000;
+  const int kOperations = 10'000'000;
+  int deque_ms = FifoPerformanceTest(Deque<int>(), kWindow, kOperations);
+  int std_ms = FifoPerformanceTest(std::deque<int>(), kWindow, kOperations);
+  int list_ms = FifoPerformanceTest(List<int>(), kWindow, kOperations);
+  std::cerr << " FIFO of " << kWindow << " elements, " << kOperations
+            << " operations: Deque " << deque_ms << " ms, std::deque "
+            << std_ms << " ms, List " << list_ms << " ms" << std::endl;
+}
+
+template <typename Alloc = std::allocator<int>>
+void TestIndexedList(Alloc alloc = Alloc()) {
+  IndexedList<int, Alloc> lst(alloc);
+  std::vector<int> model;
+  std::mt19937 rng(7);
+  for (int i = 0; i < 3'000; ++i) {
+    size_t index = rng() % (model.size() + 1);
+    if (model.empty() || rng() % 3 != 0) {
+      lst.insert_at(index, i);
+      model.insert(model.begin() + index, i);
+    } else {
+      index = rng() % model.size();
+      lst.erase_at(index);
+      model.erase(model.begin() + index);
+    }
+  }
+  assert(lst.size() == model.size());
+  assert(std::equal(lst.begin(), lst.end(), model.begin(), model.end()));
+  assert(std::equal(lst.rbegin(), lst.rend(), model.rbegin(), model.rend()));
+  const auto& const_lst = lst;
+  assert(std::equal(const_lst.crbegin(), const_lst.crend(), model.rbegin(),
+                    model.rend()));
+  for (size_t i = 0; i < model.size(); i += 7) {
+    assert(lst[i] == model[i] && lst.index_of(lst.nth(i)) == i);
+  }
+  assert(lst.index_of(lst.end()) == lst.size());
+
+  // iterators survive insertions and erasures around them
+  auto middle = lst.nth(lst.size() / 2);
+  int value = *middle;
+  lst.push_front(-1);
+  lst.erase_at(lst.size() - 1);
+  lst.insert(middle, -2);
+  assert(*middle == value && *std::prev(middle) == -2);
+  assert(lst.at(lst.index_of(middle)) == value);
+  auto next = lst.erase(std::prev(middle));
+  assert(next == middle);
+  bool thrown = false;
+  try {
+    lst.at(lst.size());
+  } catch (std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  auto copy = lst;
+  lst.pop_front();
+  assert(copy.size() == lst.size() + 1 && copy[1] == lst[0]);
+  lst = std::move(copy);
+  assert(lst.size() == model.size() && lst[0] == -1);
+  lst.clear();
+  assert(lst.empty() && lst.begin() == lst.end());
+}
+
+void TestIndexedAccess() {
+  StackStorage<1'000'000> storage;
+  TestIndexedList<StackAllocator<int, 1'000'000>>(
+      StackAllocator<int, 1'000'000>(storage));
+  static_assert(std::is_nothrow_move_assignable_v<IndexedList<int>>);
+  static_assert(!std::is_nothrow_move_assignable_v<
+                IndexedList<int, StackAllocator<int, 1'000'000>>>);
+  TestCopyAssignAllocator<IndexedList<int, OwningAllocator<int, false>>,
+                          OwningAllocator<int, false>>();
+  TestCopyAssignAllocator<IndexedList<int, OwningAllocator<int, true>>,
+                          OwningAllocator<int, true>>();
+
+  using namespace std::chrono;
+  const int kSize = 100'000;
+  const int kQueries = 2'000;
+  IndexedList<int> indexed;
+  List<int> lst;
+  for (int i = 0; i < kSize; ++i) {
+    indexed.push_back(i);
+    lst.push_back(i);
+  }
+  std::mt19937 rng(42);
+  long long indexed_sum = 0;
+  auto start = high_resolution_clock::now();
+  for (int i = 0; i < kQueries; ++i) {
+    indexed_sum += indexed[rng() % kSize];
+  }
+  auto middle = high_resolution_clock::now();
+  rng.seed(42);
+  long long list_sum = 0;
+  for (int i = 0; i < kQueries; ++i) {
+    list_sum += *std::next(lst.begin(), rng() % kSize);
+  }
+  auto finish = high_resolution_clock::now();
+  assert(indexed_sum == list_sum);
+  std::cerr << " " << kQueries << " random positions in " << kSize
+            << " elements: IndexedList "
+            << duration_cast<microseconds>(middle - start).count()
+            << " us, List walk "
+            << duration_cast<microseconds>(finish - middle).count() << " us"
+            << std::endl;
+}
+
+void TestTraversal() {
+  const size_t kSize = 100'000;
+  const size_t kArena = 4 * kSize * sizeof(long long) + 1'000;
+  auto storage = std::make_unique<StackStorage<kArena>>();
+  using ArenaList = List<long long, StackAllocator<long long, kArena>>;
+  ArenaList lst(kSize, 1, StackAllocator<long long, kArena>(*storage));
+
+  std::mutex mutex;
+  std::set<std::thread::id> workers;
+  auto count_workers = [&](long long& element) {
+    element *= 2;
+    std::lock_guard lock(mutex);
+    workers.insert(std::this_thread::get_id());
+  };
+  // the fill constructor leaves the nodes back to back, so they are split
+  lst.parallel_for_each(count_workers, 4);
+  assert(workers.size() == 4);
+  long long sum = 0;
+  lst.for_each([&sum](long long element) { sum += element; });
+  assert(sum == 2 * static_cast<long long>(kSize));
+
+  // a node out of order falls back to a single thread
+  workers.clear();
+  lst.pop_back();
+  lst.push_front(2);
+  lst.parallel_for_each(count_workers, 4);
+  assert(workers.size() == 1);
+  for (long long element : lst) {
+    assert(element == 4);
+  }
+
+  List<long long> regular(kSize, 1);
+  std::atomic<long long> total = 0;
+  regular.parallel_for_each(
+      [&total](long long element) {
+        total.fetch_add(element, std::memory_order_relaxed);
+      },
+      4);
+  assert(total == static_cast<long long>(kSize));
+}
+
+void TestTraversalPerformance() {
+  using namespace std::chrono;
+  const size_t kSize = 4'000'000;
+  const size_t kArena = kSize * 24 + 1'000;
+  auto storage = std::make_unique<StackStorage<kArena>>();
+  List<long long, StackAllocator<long long, kArena>> arena_list(
+      kSize, 1, StackAllocator<long long, kArena>(*storage));
+  // sorting random keys relinks the nodes into an order unrelated to their
+  // addresses, as after a long run of inserts and erases
+  List<long long> scattered;
+  std::mt19937 rng(1);
+  for (size_t i = 0; i < kSize; ++i) {
+    scattered.push_back(rng() % 1'000);
+  }
+  scattered.sort();
+
+  // a body with some arithmetic in it, the lookahead of for_each hides the
+  // misses behind it while the range-for waits on each of them
+  unsigned long long hash = 0;
+  auto mix = [&hash](long long element) {
+    auto value = static_cast<unsigned long long>(element);
+    for (int i = 0; i < 50; ++i) {
+      value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    hash += value;
+  };
+  auto start = high_resolution_clock::now();
+  for (long long element : scattered) {
+    mix(element);
+  }
+  unsigned long long walked_hash = hash;
+  auto walked = high_resolution_clock::now();
+  scattered.for_each(mix);
+  auto prefetched = high_resolution_clock::now();
+  std::atomic<long long> total = 0;
+  arena_list.parallel_for_each([&total](long long element) {
+    total.fetch_add(element, std::memory_order_relaxed);
+  });
+  auto parallel = high_resolution_clock::now();
+  assert(hash == 2 * walked_hash && total == static_cast<long long>(kSize));
+  std::cerr << " Scan of " << kSize << " scattered elements: range-for "
+            << duration_cast<milliseconds>(walked - start).count()
+            << " ms, for_each "
+            << duration_cast<milliseconds>(prefetched - walked).count()
+            << " ms; parallel_for_each over an arena "
+            << duration_cast<milliseconds>(parallel - prefetched).count()
+            << " ms" << std::endl;
+}
+
+template <typename Alloc = std::allocator<int>>
+void TestUnrolledList(Alloc alloc = Alloc()) {
+  UnrolledList<int, Alloc, 4> lst(alloc);
+  for (int i = 0; i < 10; ++i) {
+    lst.push_back(i);
+  }
+  lst.push_front(-1);
+  assert(lst.size() == 11);
+
+  // inserting into full nodes splits them
+  auto it = std::next(lst.cbegin(), 3);
+  it = lst.insert(it, 100);
+  it = lst.insert(it, 200);
+  std::string s;
+  for (int x : lst) {
+    s += std::to_string(x) + ",";
+  }
+  assert(s == "-1,0,1,200,100,2,3,4,5,6,7,8,9,");
+
+  lst.erase(lst.cbegin());
+  lst.pop_back();
+  lst.pop_front();
+  it = std::prev(lst.cend(), 2);
+  assert(*lst.erase(it) == 8);
+  s.clear();
+  for (auto rit = lst.crbegin(); rit != lst.crend(); ++rit) {
+    s += std::to_string(*rit) + ",";
+  }
+  assert(s == "8,6,5,4,3,2,100,200,1,");
+
+  const auto copy = lst;
+  while (lst.size() > 0) {
+    lst.pop_back();
+  }
+  assert(lst.begin() == lst.end());
+  assert(copy.size() == 9);
+  assert(*copy.rbegin() == 8);
+
+  UnrolledList<std::string, std::allocator<std::string>, 3> strings(
+      5, "unrolled");
+  strings.insert(std::next(strings.cbegin()), "list");
+  assert(*std::next(strings.begin()) == "list");
+  assert(strings.size() == 6);
+
+  // inserting an element of a full node into that node splits it first
+  UnrolledList<std::string, std::allocator<std::string>, 3> full;
+  for (const char* word : {"one", "two", "three"}) {
+    full.push_back(word);
+  }
+  full.insert(full.cbegin(), *std::prev(full.end()));
+  full.insert(std::next(full.cbegin()), *std::next(full.begin()));
+  std::vector<std::string> expected = {"three", "one", "one", "two", "three"};
+  assert(std::equal(full.begin(), full.end(), expected.begin(),
+                    expected.end()));
+
+  ThrowingAccountant::need_throw = false;
+  ThrowingAccountant source;
+  Accountant::reset();
+  ThrowingAccountant::need_throw = true;
+  bool thrown = false;
+  try {
+    UnrolledList<ThrowingAccountant, std::allocator<ThrowingAccountant>, 3>
+        accounts(10, source);
+  } catch (...) {
+    thrown = true;
+  }
+  ThrowingAccountant::need_throw = false;
+  assert(thrown && Accountant::ctor_calls == Accountant::dtor_calls);
+}
+
+template <class Container>
+int ScanPerformanceTest(Container&& container, int elements, int scans) {
+  using namespace std::chrono;
+  for (int i = 0; i < elements; ++i) {
+    container.push_back(i);
+  }
+
+  auto start = high_resolution_clock::now();
+  long long sum = 0;
+  for (int j = 0; j < scans; ++j) {
+    for (int x : container) {
+      sum += x;
+    }
+  }
+  auto finish = high_resolution_clock::now();
+
+  assert(sum == static_cast<long long>(elements) * (elements - 1) / 2 * scans);
+  return duration_cast<milliseconds>(finish - start).count();
+}
+
+void TestScanPerformance() {
+  const int kElements = 2'000'000;
+  const int kScans = 5;
+  int list_ms = ScanPerformanceTest(List<int>(), kElements, kScans);
+  int unrolled_ms = ScanPerformanceTest(UnrolledList<int>(), kElements, kScans);
+  std::cerr << " Scanning " << kElements << " elements " << kScans
+            << " times: List " << list_ms << " ms, UnrolledList "
+            << unrolled_ms << " ms" << std::endl;
+}
+
+void TestCompactList() {
+  const size_t kSize = 400'000;
+  auto storage = std::make_unique<StackStorage<kSize>>();
+  CompactList<int, kSize> lst(*storage);
+  for (int i = 0; i < 1'000; ++i) {
+    lst.push_back(i);
+  }
+  // three 32-bit words per node, half of what List<int> takes
+  assert(storage->offset <= 1'000 * 3 * sizeof(int));
+  lst.push_front(-1);
+  auto it = lst.insert(std::next(lst.cbegin(), 2), 100);
+  assert(*std::prev(it) == 0 && *std::next(it) == 1);
+  it = lst.erase(it);
+  assert(*it == 1 && lst.size() == 1'001);
+  assert(*lst.rbegin() == 999 && lst.front() == -1);
+
+  // erased nodes are reused before the arena grows
+  size_t offset = storage->offset;
+  for (int i = 0; i < 500; ++i) {
+    lst.pop_front();
+  }
+  for (int i = 0; i < 500; ++i) {
+    lst.push_back(i);
+  }
+  assert(storage->offset == offset);
+
+  CompactList<int, kSize> copy = lst;
+  lst.clear();
+  assert(lst.empty() && copy.size() == 1'001 && copy.back() == 499);
+  CompactList<std::string, kSize> strings(3, "abc", *storage);
+  strings.emplace_back(5, 'x');
+  assert(*strings.crbegin() == "xxxxx" && strings.size() == 4);
+
+  const int kElements = 1'000'000;
+  auto big = std::make_unique<StackStorage<100'000'000>>();
+  int list_ms = ScanPerformanceTest(
+      List<int, StackAllocator<int, 100'000'000>>(*big), kElements, 5);
+  int compact_ms = ScanPerformanceTest(
+      CompactList<int, 100'000'000>(*big), kElements, 5);
+  std::cerr << " Scanning " << kElements << " elements 5 times: List "
+            << list_ms << " ms, CompactList " << compact_ms << " ms"
+            << std::endl;
+}
+
 template <typename Alloc>
 void DequeTest() {
   Alloc alloc(STATIC_STORAGE);
@@ -609,7 +1936,9 @@ int main() {
 
   std::cerr << "Test 3 (ExceptionSafety) passed." << std::endl;
 
-  // TestAlignment();
+  TestAlignment();
+  TestLargeArena();
+  TestDenseNodeAllocation();
 
   std::cerr << "Test 4 (Alignment) passed." << std::endl;
 
@@ -633,6 +1962,109 @@ int main() {
 
   std::cerr << "Test 7 (Allocator Awareness) passed." << std::endl;
 
+  TestChunkedStorage();
+
+  std::cerr << "Test 8 (ChunkedStackStorage) passed." << std::endl;
+
+  TestPoolAllocator();
+
+  std::cerr << "Test 9 (PoolAllocator) passed." << std::endl;
+
+  TestUnrolledList<>();
+  {
+    StackStorage<200'000> storage;
+    StackAllocator<int, 200'000> alloc(storage);
+
+    TestUnrolledList<StackAllocator<int, 200'000>>(alloc);
+  }
+  TestCopyAssignAllocator<UnrolledList<int, OwningAllocator<int, false>, 4>,
+                          OwningAllocator<int, false>>();
+  TestCopyAssignAllocator<UnrolledList<int, OwningAllocator<int, true>, 4>,
+                          OwningAllocator<int, true>>();
+  TestScanPerformance();
+
+  std::cerr << "Test 10 (UnrolledList) passed." << std::endl;
+
+  TestMoveSemantics();
+
+  std::cerr << "Test 11 (Move semantics) passed." << std::endl;
+
+  TestRelinking<>();
+  {
+    StackStorage<200'000> storage;
+    StackAllocator<int, 200'000> alloc(storage);
+
+    TestRelinking<StackAllocator<int, 200'000>>(alloc);
+    size_t offset = storage.offset;
+    List<int, StackAllocator<int, 200'000>> lst(alloc);
+    for (int i = 0; i < 100; ++i) {
+      lst.push_front(i);
+    }
+    offset = storage.offset;
+    lst.sort();
+    lst.reverse();
+    assert(storage.offset == offset);
+  }
+
+  std::cerr << "Test 12 (splice, merge, sort) passed." << std::endl;
+
+  TestSentinel();
+
+  std::cerr << "Test 13 (Sentinel) passed." << std::endl;
+
+  TestBulkConstruction();
+
+  std::cerr << "Test 14 (bulk construction) passed." << std::endl;
+
+  TestIntrusiveList();
+
+  std::cerr << "Test 15 (intrusive list) passed." << std::endl;
+
+  TestConcurrentQueue<>();
+  {
+    ChunkedStackStorage storage;
+    TestConcurrentQueue<ChunkedStackAllocator<long long>>(storage);
+  }
+  TestQueueContention();
+
+  std::cerr << "Test 16 (ConcurrentQueue) passed." << std::endl;
+
+  TestThreadArenas();
+
+  std::cerr << "Test 17 (thread arenas) passed." << std::endl;
+
+  TestCompactList();
+
+  std::cerr << "Test 18 (CompactList) passed." << std::endl;
+
+  TestRingDeque<>();
+  TestDequeGrowth();
+
+  std::cerr << "Test 19 (Deque) passed." << std::endl;
+
+  TestArenaScopes();
+
+  std::cerr << "Test 20 (arena scopes) passed." << std::endl;
+
+  TestArenaResource();
+
+  std::cerr << "Test 21 (ArenaResource) passed." << std::endl;
+
+  TestTracingAllocator();
+
+  std::cerr << "Test 22 (TracingAllocator) passed." << std::endl;
+
+  TestIndexedList<>();
+  TestIndexedAccess();
+
+  std::cerr << "Test 23 (IndexedList) passed." << std::endl;
+
+  TestTraversal();
+  TestTraversalPerformance();
+
+  std::cerr << "Test 24 (prefetching and parallel traversal) passed."
+            << std::endl;
+
   std::cerr << "Starting performance test. First, let's test performance of "
                "different allocators with std::list."
             << std::endl;
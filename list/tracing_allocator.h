@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide allocation profile fed by TracingAllocator. Tracing is off
+// until enable() is called; until then every hook is one relaxed load and
+// an untaken branch. Once enabled, each call takes a mutex to record the
+// block, so keep it to profiling runs.
+//
+// Call sites are named by TraceTag scopes, e.g.
+//
+//   TraceTag tag("parse_request");
+//   List<Header, TracingAllocator<std::allocator<Header>>> headers;
+//
+// attributes every traced allocation made by this thread inside the scope
+// to "parse_request".
+class AllocationTracer {
+ public:
+  // bucket i holds values of [2^(i-1), 2^i), the last one is open
+  static constexpr size_t kHistogramBuckets = 48;
+  using Histogram = std::array<unsigned long long, kHistogramBuckets>;
+
+  struct Site {
+    unsigned long long allocations = 0;
+    unsigned long long bytes = 0;
+  };
+
+  struct Snapshot {
+    unsigned long long allocations = 0;
+    unsigned long long deallocations = 0;
+    unsigned long long allocated_bytes = 0;
+    unsigned long long live_bytes = 0;
+    unsigned long long peak_live_bytes = 0;
+    Histogram sizes{};
+    // nanoseconds between allocation and deallocation
+    Histogram lifetimes{};
+    std::map<std::string, Site> sites;
+  };
+
+  // the first enable() also registers a summary dump to std::cerr at exit
+  static void enable(bool on = true);
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static Snapshot snapshot();
+  static void reset();
+
+  static void record_allocation(void* ptr, size_t bytes);
+  static void record_deallocation(void* ptr);
+
+ private:
+  friend class TraceTag;
+
+  struct Block {
+    size_t bytes;
+    std::chrono::steady_clock::time_point allocated;
+  };
+
+  inline static std::atomic<bool> enabled_ = false;
+  inline static std::once_flag dump_registered_;
+  inline static thread_local const char* current_tag_ = "untagged";
+
+  // leaked so that blocks freed during static destruction can still be traced
+  static AllocationTracer& instance();
+  static size_t bucket(unsigned long long value) {
+    return std::min<size_t>(std::bit_width(value), kHistogramBuckets - 1);
+  }
+
+  std::mutex mutex_;
+  Snapshot totals_;
+  std::unordered_map<void*, Block> live_;
+};
+
+// Names the call site for allocations traced by this thread in its scope
+class TraceTag {
+ public:
+  explicit TraceTag(const char* tag)
+      : previous_(AllocationTracer::current_tag_) {
+    AllocationTracer::current_tag_ = tag;
+  }
+  ~TraceTag() { AllocationTracer::current_tag_ = previous_; }
+  TraceTag(const TraceTag&) = delete;
+  TraceTag& operator=(const TraceTag&) = delete;
+
+ private:
+  const char* previous_;
+};
+
+// Forwards to Alloc and reports every block to AllocationTracer. Works with
+// List and with standard containers; equality, propagation and copy
+// construction behave as they do for Alloc. The bump-allocator tag is not
+// forwarded: List would then allocate nodes in batches and skip
+// deallocation on clear(), and the trace would lose its per-block counts.
+template <typename Alloc>
+struct TracingAllocator {
+  using Traits = std::allocator_traits<Alloc>;
+  using value_type = typename Traits::value_type;
+  using propagate_on_container_copy_assignment =
+      typename Traits::propagate_on_container_copy_assignment;
+  using propagate_on_container_move_assignment =
+      typename Traits::propagate_on_container_move_assignment;
+  using propagate_on_container_swap =
+      typename Traits::propagate_on_container_swap;
+  using is_always_equal = typename Traits::is_always_equal;
+
+  [[no_unique_address]] Alloc inner;
+
+  TracingAllocator() = default;
+  TracingAllocator(const Alloc& alloc) : inner(alloc) {}
+  template <typename Other>
+  TracingAllocator(const TracingAllocator<Other>& other)
+      : inner(other.inner) {}
+  template <typename U>
+  struct rebind {
+    using other = TracingAllocator<typename Traits::template rebind_alloc<U>>;
+  };
+
+  value_type* allocate(size_t count) {
+    value_type* ptr = Traits::allocate(inner, count);
+    if (AllocationTracer::enabled()) {
+      AllocationTracer::record_allocation(ptr, count * sizeof(value_type));
+    }
+    return ptr;
+  }
+  void deallocate(value_type* ptr, size_t count) {
+    if (AllocationTracer::enabled()) {
+      AllocationTracer::record_deallocation(ptr);
+    }
+    Traits::deallocate(inner, ptr, count);
+  }
+  TracingAllocator select_on_container_copy_construction() const {
+    return TracingAllocator(
+        Traits::select_on_container_copy_construction(inner));
+  }
+};
+
+template <typename First, typename Second>
+bool operator==(const TracingAllocator<First>& first,
+                const TracingAllocator<Second>& second) {
+  return first.inner == second.inner;
+}
+
+template <typename First, typename Second>
+bool operator!=(const TracingAllocator<First>& first,
+                const TracingAllocator<Second>& second) {
+  return !(first == second);
+}
+
+inline AllocationTracer& AllocationTracer::instance() {
+  static AllocationTracer* tracer = new AllocationTracer();
+  return *tracer;
+}
+
+inline std::ostream& operator<<(std::ostream& ostream,
+                                const AllocationTracer::Snapshot& snap) {
+  ostream << "alloc.allocations " << snap.allocations << '\n';
+  ostream << "alloc.deallocations " << snap.deallocations << '\n';
+  ostream << "alloc.allocated_bytes " << snap.allocated_bytes << '\n';
+  ostream << "alloc.live_bytes " << snap.live_bytes << '\n';
+  ostream << "alloc.peak_live_bytes " << snap.peak_live_bytes << '\n';
+  auto histogram = [&ostream](const char* name,
+                              const AllocationTracer::Histogram& counts) {
+    for (size_t i = 0; i < AllocationTracer::kHistogramBuckets; ++i) {
+      if (counts[i] == 0) {
+        continue;
+      }
+      ostream << "alloc." << name;
+      if (i + 1 == AllocationTracer::kHistogramBuckets) {
+        ostream << "_ge_" << (1ULL << (i - 1));
+      } else {
+        ostream << "_le_" << ((1ULL << i) - 1);
+      }
+      ostream << ' ' << counts[i] << '\n';
+    }
+  };
+  histogram("size_bytes", snap.sizes);
+  histogram("lifetime_ns", snap.lifetimes);
+  for (const auto& [tag, site] : snap.sites) {
+    ostream << "alloc.site." << tag << ".allocations " << site.allocations
+            << '\n';
+    ostream << "alloc.site." << tag << ".bytes " << site.bytes << '\n';
+  }
+  return ostream;
+}
+
+inline void AllocationTracer::enable(bool on) {
+  if (on) {
+    std::call_once(dump_registered_, [] {
+      std::atexit([] {
+        Snapshot snap = snapshot();
+        if (snap.allocations != 0) {
+          std::cerr << "allocation trace summary\n" << snap;
+        }
+      });
+    });
+  }
+  enabled_.store(on, std::memory_order_relaxed);
+}
+
+inline AllocationTracer::Snapshot AllocationTracer::snapshot() {
+  AllocationTracer& tracer = instance();
+  std::lock_guard lock(tracer.mutex_);
+  return tracer.totals_;
+}
+
+inline void AllocationTracer::reset() {
+  AllocationTracer& tracer = instance();
+  std::lock_guard lock(tracer.mutex_);
+  tracer.totals_ = Snapshot();
+  tracer.live_.clear();
+}
+
+inline void AllocationTracer::record_allocation(void* ptr, size_t bytes) {
+  AllocationTracer& tracer = instance();
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard lock(tracer.mutex_);
+  Snapshot& totals = tracer.totals_;
+  ++totals.allocations;
+  totals.allocated_bytes += bytes;
+  totals.live_bytes += bytes;
+  totals.peak_live_bytes = std::max(totals.peak_live_bytes, totals.live_bytes);
+  ++totals.sizes[bucket(bytes)];
+  Site& site = totals.sites[current_tag_];
+  ++site.allocations;
+  site.bytes += bytes;
+  tracer.live_[ptr] = Block{bytes, now};
+}
+
+// Blocks allocated while tracing was off are not known and are skipped
+inline void AllocationTracer::record_deallocation(void* ptr) {
+  AllocationTracer& tracer = instance();
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard lock(tracer.mutex_);
+  auto it = tracer.live_.find(ptr);
+  if (it == tracer.live_.end()) {
+    return;
+  }
+  Snapshot& totals = tracer.totals_;
+  ++totals.deallocations;
+  totals.live_bytes -= it->second.bytes;
+  auto lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - it->second.allocated);
+  ++totals.lifetimes[bucket(lifetime.count())];
+  tracer.live_.erase(it);
+}
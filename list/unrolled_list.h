@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "list+stackallocator.h"
+
+// Doubly linked list of nodes holding up to K elements each, a scan touches
+// one node per K elements instead of one per element.
+//
+// Iterator stability: insert and erase move elements only inside the node
+// they touch (and, when a full node is split, into the new neighbour node),
+// so iterators to that node are invalidated while iterators to all other
+// nodes and end() stay valid.
+template <typename T, typename Alloc = std::allocator<T>, size_t K = 32>
+class UnrolledList {
+  static_assert(K > 1, "UnrolledList needs at least two elements per node");
+
+ private:
+  struct Node {
+    Node* prev = nullptr;
+    Node* next = nullptr;
+    size_t count = 0;
+    alignas(T) unsigned char storage[K * sizeof(T)];
+
+    T* slot(size_t i) { return reinterpret_cast<T*>(storage) + i; }
+  };
+
+  using NodeAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  Node* head_ = nullptr;
+  Node* tail_ = nullptr;
+  size_t size_ = 0;
+  [[no_unique_address]] NodeAlloc allocator_;
+
+  Node* create_node();
+  void destroy_node(Node* node);
+  void link_after(Node* node, Node* new_node);
+  void unlink(Node* node);
+  void split(Node* node);
+  void swap(UnrolledList& other);
+  // destroys every node and its elements
+  void release();
+
+ public:
+  template <bool IsConst>
+  class iterator_common {
+   public:
+    using value_type = T;
+    using difference_type = int;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using list_pointer =
+        std::conditional_t<IsConst, const UnrolledList*, UnrolledList*>;
+
+    list_pointer list_iter = nullptr;
+    Node* node = nullptr;
+    size_t index = 0;
+
+    iterator_common() = default;
+    iterator_common(list_pointer list, Node* node, size_t index)
+        : list_iter(list), node(node), index(index) {}
+    operator iterator_common<true>() const {
+      return iterator_common<true>(list_iter, node, index);
+    }
+
+    reference operator*() const { return *node->slot(index); }
+    pointer operator->() const { return node->slot(index); }
+    iterator_common& operator++();
+    iterator_common operator++(int) {
+      iterator_common copy = *this;
+      ++*this;
+      return copy;
+    }
+    iterator_common& operator--();
+    iterator_common operator--(int) {
+      iterator_common copy = *this;
+      --*this;
+      return copy;
+    }
+    bool operator==(const iterator_common& other) const {
+      return node == other.node && index == other.index;
+    }
+    bool operator!=(const iterator_common& other) const {
+      return !(*this == other);
+    }
+  };
+
+  using iterator = iterator_common<false>;
+  using const_iterator = iterator_common<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  UnrolledList() = default;
+  ~UnrolledList();
+  UnrolledList(Alloc allocator);
+  UnrolledList(size_t size, const T& element, Alloc allocator = Alloc());
+  UnrolledList(const UnrolledList& other);
+  UnrolledList& operator=(const UnrolledList& other);
+  NodeAlloc get_allocator() { return allocator_; }
+  size_t size() const { return size_; }
+  void push_back(const T& new_t);
+  void push_front(const T& new_t);
+  void pop_back();
+  void pop_front();
+  iterator insert(const_iterator it, const T& element);
+  iterator erase(const_iterator it);
+
+  iterator begin() { return iterator(this, head_, 0); }
+  iterator end() { return iterator(this, nullptr, 0); }
+  const_iterator begin() const { return const_iterator(this, head_, 0); }
+  const_iterator end() const { return const_iterator(this, nullptr, 0); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+  const_reverse_iterator crend() const { return rend(); }
+};
+
+template <typename T, typename Alloc, size_t K>
+template <bool IsConst>
+typename UnrolledList<T, Alloc, K>::template iterator_common<IsConst>&
+UnrolledList<T, Alloc, K>::iterator_common<IsConst>::operator++() {
+  if (++index == node->count) {
+    node = node->next;
+    index = 0;
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc, size_t K>
+template <bool IsConst>
+typename UnrolledList<T, Alloc, K>::template iterator_common<IsConst>&
+UnrolledList<T, Alloc, K>::iterator_common<IsConst>::operator--() {
+  if (node == nullptr) {
+    node = list_iter->tail_;
+    index = node->count - 1;
+  } else if (index == 0) {
+    node = node->prev;
+    index = node->count - 1;
+  } else {
+    --index;
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc, size_t K>
+typename UnrolledList<T, Alloc, K>::Node*
+UnrolledList<T, Alloc, K>::create_node() {
+  Node* node = NodeTraits::allocate(allocator_, 1);
+  return new (node) Node();
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::destroy_node(Node* node) {
+  for (size_t i = 0; i < node->count; ++i) {
+    NodeTraits::destroy(allocator_, node->slot(i));
+  }
+  node->~Node();
+  NodeTraits::deallocate(allocator_, node, 1);
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::link_after(Node* node, Node* new_node) {
+  new_node->prev = node;
+  new_node->next = (node != nullptr) ? node->next : head_;
+  if (new_node->next != nullptr) {
+    new_node->next->prev = new_node;
+  } else {
+    tail_ = new_node;
+  }
+  if (node != nullptr) {
+    node->next = new_node;
+  } else {
+    head_ = new_node;
+  }
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::unlink(Node* node) {
+  (node->prev != nullptr ? node->prev->next : head_) = node->next;
+  (node->next != nullptr ? node->next->prev : tail_) = node->prev;
+}
+
+// Moves the upper half of a full node into a fresh node right after it
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::split(Node* node) {
+  Node* new_node = create_node();
+  size_t half = node->count / 2;
+  for (size_t i = half; i < node->count; ++i) {
+    NodeTraits::construct(allocator_, new_node->slot(i - half),
+                          std::move(*node->slot(i)));
+    ++new_node->count;
+  }
+  for (size_t i = half; i < node->count; ++i) {
+    NodeTraits::destroy(allocator_, node->slot(i));
+  }
+  node->count = half;
+  link_after(node, new_node);
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::swap(UnrolledList& other) {
+  std::swap(head_, other.head_);
+  std::swap(tail_, other.tail_);
+  std::swap(size_, other.size_);
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::release() {
+  while (head_ != nullptr) {
+    Node* next = head_->next;
+    destroy_node(head_);
+    head_ = next;
+  }
+  tail_ = nullptr;
+  size_ = 0;
+}
+
+template <typename T, typename Alloc, size_t K>
+UnrolledList<T, Alloc, K>::~UnrolledList() {
+  release();
+}
+
+template <typename T, typename Alloc, size_t K>
+UnrolledList<T, Alloc, K>::UnrolledList(Alloc allocator)
+    : allocator_(allocator) {}
+
+template <typename T, typename Alloc, size_t K>
+UnrolledList<T, Alloc, K>::UnrolledList(size_t size, const T& element,
+                                        Alloc allocator)
+    : allocator_(allocator) {
+  try {
+    for (size_t i = 0; i < size; ++i) {
+      push_back(element);
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc, size_t K>
+UnrolledList<T, Alloc, K>::UnrolledList(const UnrolledList& other)
+    : allocator_(
+          NodeTraits::select_on_container_copy_construction(other.allocator_)) {
+  try {
+    for (const T& element : other) {
+      push_back(element);
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+template <typename T, typename Alloc, size_t K>
+UnrolledList<T, Alloc, K>& UnrolledList<T, Alloc, K>::operator=(
+    const UnrolledList& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // the copy is built by the allocator this list ends up with and the old
+  // nodes leave together with the allocator that made them
+  constexpr bool kPropagate =
+      NodeTraits::propagate_on_container_copy_assignment::value;
+  UnrolledList new_list(allocator_);
+  if constexpr (kPropagate) {
+    new_list.allocator_ = other.allocator_;
+  }
+  for (const T& element : other) {
+    new_list.push_back(element);
+  }
+  swap(new_list);
+  if constexpr (kPropagate) {
+    std::swap(allocator_, new_list.allocator_);
+  }
+  return *this;
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::push_back(const T& new_t) {
+  insert(cend(), new_t);
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::push_front(const T& new_t) {
+  insert(cbegin(), new_t);
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::pop_back() {
+  erase(--cend());
+}
+
+template <typename T, typename Alloc, size_t K>
+void UnrolledList<T, Alloc, K>::pop_front() {
+  erase(cbegin());
+}
+
+template <typename T, typename Alloc, size_t K>
+typename UnrolledList<T, Alloc, K>::iterator UnrolledList<T, Alloc, K>::insert(
+    const_iterator it, const T& element) {
+  // element may live in a node that split() or the shift below moves from
+  T copy(element);
+  Node* node = it.node;
+  size_t index = it.index;
+  if (node == nullptr) {
+    // appending goes to the tail node while it has room
+    if (tail_ == nullptr || tail_->count == K) {
+      link_after(tail_, create_node());
+    }
+    node = tail_;
+    index = node->count;
+  } else if (node->count == K) {
+    split(node);
+    if (index > node->count) {
+      index -= node->count;
+      node = node->next;
+    }
+  }
+  if (index == node->count) {
+    NodeTraits::construct(allocator_, node->slot(index), std::move(copy));
+  } else {
+    NodeTraits::construct(allocator_, node->slot(node->count),
+                          std::move(*node->slot(node->count - 1)));
+    std::move_backward(node->slot(index), node->slot(node->count - 1),
+                       node->slot(node->count));
+    *node->slot(index) = std::move(copy);
+  }
+  ++node->count;
+  ++size_;
+  return iterator(this, node, index);
+}
+
+template <typename T, typename Alloc, size_t K>
+typename UnrolledList<T, Alloc, K>::iterator UnrolledList<T, Alloc, K>::erase(
+    const_iterator it) {
+  Node* node = it.node;
+  size_t index = it.index;
+  std::move(node->slot(index + 1), node->slot(node->count), node->slot(index));
+  NodeTraits::destroy(allocator_, node->slot(--node->count));
+  --size_;
+  if (node->count == 0) {
+    Node* next = node->next;
+    unlink(node);
+    destroy_node(node);
+    return iterator(this, next, 0);
+  }
+  if (index == node->count) {
+    return iterator(this, node->next, 0);
+  }
+  return iterator(this, node, index);
+}